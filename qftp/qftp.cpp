@@ -51,17 +51,28 @@
 #include "qtcpsocket.h"
 #include "qurlinfo.h"
 #include "qstringlist.h"
-#include "qregexp.h"
 #include "qtimer.h"
 #include "qfileinfo.h"
 #include "qhash.h"
 #include "qtcpserver.h"
-#include "qlocale.h"
 
 QT_BEGIN_NAMESPACE
 
 class QFtpPI;
 
+/*
+    Options of a batched list() command; see QFtp::listInfos().
+*/
+struct QFtpListOptions
+{
+    QFtpListOptions() : batched(false), batchSize(0) {}
+
+    bool batched;
+    int batchSize;
+    QFtp::ListPredicate filter;
+    QFtp::ListPredicate stop;
+};
+
 /*
     The QFtpDTP (DTP = Data Transfer Process) controls all client side
     data transfer between the client and server.
@@ -85,6 +96,8 @@ public:
     void setDevice(QIODevice *);
     void writeData();
     void setBytesTotal(qint64 bytes);
+    void setTransferOffset(qint64 offset);
+    void setListOptions(const QFtpListOptions &options);
 
     bool hasError() const;
     QString errorMessage() const;
@@ -102,9 +115,11 @@ public:
     void abortConnection();
 
     static bool parseDir(const QByteArray &buffer, const QString &userName, QUrlInfo *info);
+    static bool parseMlsdLine(const QByteArray &buffer, QUrlInfo *info);
 
 signals:
     void listInfo(const QUrlInfo&);
+    void listInfos(const QVector<QUrlInfo>&);
     void readyRead();
     void dataTransferProgress(qint64, qint64);
 
@@ -122,6 +137,8 @@ private slots:
 
 private:
     void clearData();
+    void addListEntry(const QUrlInfo &info);
+    void flushListEntries();
 
     QTcpSocket *socket;
     QTcpServer listener;
@@ -130,6 +147,7 @@ private:
     QString err;
     qint64 bytesDone;
     qint64 bytesTotal;
+    qint64 bytesOffset;
     bool callWriteData;
 
     // If is_ba is true, ba is used; ba is never 0.
@@ -141,6 +159,10 @@ private:
     bool is_ba;
 
     QByteArray bytesFromSocket;
+
+    QFtpListOptions listOptions;
+    QVector<QUrlInfo> listBuffer;
+    bool listStopped;
 };
 
 /**********************************************************************
@@ -165,9 +187,14 @@ public:
     void clearPendingCommands();
     void abort();
 
-    QString currentCommand() const
+    QByteArray currentCommand() const
         { return currentCmd; }
 
+    bool hasFeature(const QByteArray &feature) const
+        { return features.contains(feature.toUpper()); }
+    void removeFeature(const QByteArray &feature)
+        { features.removeAll(feature.toUpper()); }
+
     bool rawCommand;
     bool transferConnectionExtended;
 
@@ -210,12 +237,16 @@ private:
     bool startNextCmd();
 
     QTcpSocket commandSocket;
-    QString replyText;
+    // the control channel is kept as raw bytes; replies are only turned into
+    // QStrings when they leave the PI through a signal
+    QByteArray replyText;
     char replyCode[3];
     State state;
     AbortState abortState;
-    QStringList pendingCommands;
-    QString currentCmd;
+    QList<QByteArray> pendingCommands;
+    QByteArray currentCmd;
+    QByteArray dataConnectionCmd;
+    QList<QByteArray> features;
 
     bool waitForDtpToConnect;
     bool waitForDtpToClose;
@@ -240,6 +271,8 @@ public:
     int id;
     QFtp::Command command;
     QStringList rawCmds;
+    QFtpListOptions listOptions;
+    qint64 offset; // Get/Put: where in the file the transfer starts
 
     // If is_ba is true, ba is used; ba is never 0.
     // Otherwise dev is used; dev can be 0 or not.
@@ -255,14 +288,14 @@ public:
 QBasicAtomicInt QFtpCommand::idCounter = Q_BASIC_ATOMIC_INITIALIZER(1);
 
 QFtpCommand::QFtpCommand(QFtp::Command cmd, QStringList raw, const QByteArray &ba)
-    : command(cmd), rawCmds(raw), is_ba(true)
+    : command(cmd), rawCmds(raw), offset(0), is_ba(true)
 {
     id = idCounter.fetchAndAddRelaxed(1);
     data.ba = new QByteArray(ba);
 }
 
 QFtpCommand::QFtpCommand(QFtp::Command cmd, QStringList raw, QIODevice *dev)
-    : command(cmd), rawCmds(raw), is_ba(false)
+    : command(cmd), rawCmds(raw), offset(0), is_ba(false)
 {
     id = idCounter.fetchAndAddRelaxed(1);
     data.dev = dev;
@@ -284,7 +317,9 @@ QFtpDTP::QFtpDTP(QFtpPI *p, QObject *parent) :
     socket(0),
     listener(this),
     pi(p),
-    callWriteData(false)
+    bytesOffset(0),
+    callWriteData(false),
+    listStopped(false)
 {
     clearData();
     listener.setObjectName(QLatin1String("QFtpDTP active state server"));
@@ -306,10 +341,56 @@ void QFtpDTP::setDevice(QIODevice *dev)
 void QFtpDTP::setBytesTotal(qint64 bytes)
 {
     bytesTotal = bytes;
-    bytesDone = 0;
+    bytesDone = bytesOffset;
     emit dataTransferProgress(bytesDone, bytesTotal);
 }
 
+/*
+  Resumed transfers start \a offset bytes into the file; progress is still
+  reported against the size of the whole file.
+*/
+void QFtpDTP::setTransferOffset(qint64 offset)
+{
+    bytesOffset = offset;
+}
+
+void QFtpDTP::setListOptions(const QFtpListOptions &options)
+{
+    listOptions = options;
+    listBuffer.clear();
+    listStopped = false;
+    if (options.batchSize > 0)
+        listBuffer.reserve(options.batchSize);
+}
+
+/*
+    Collects one parsed entry of a batched listing, applying the filter and
+    stop predicates. Entries are delivered through listInfos() whenever a
+    batch is full and once more when the data connection closes.
+*/
+void QFtpDTP::addListEntry(const QUrlInfo &info)
+{
+    if (!listOptions.filter || listOptions.filter(info))
+        listBuffer.append(info);
+    if (listOptions.stop && listOptions.stop(info)) {
+        listStopped = true;
+        flushListEntries();
+    } else if (listOptions.batchSize > 0 && listBuffer.size() >= listOptions.batchSize) {
+        flushListEntries();
+    }
+}
+
+void QFtpDTP::flushListEntries()
+{
+    if (listBuffer.isEmpty())
+        return;
+    QVector<QUrlInfo> entries;
+    entries.swap(listBuffer);
+    if (listOptions.batchSize > 0)
+        listBuffer.reserve(listOptions.batchSize);
+    emit listInfos(entries);
+}
+
 void QFtpDTP::connectToHost(const QString & host, quint16 port)
 {
     bytesFromSocket.clear();
@@ -477,16 +558,110 @@ static void _q_fixupDateTime(QDateTime *dateTime)
     }
 }
 
-static void _q_parseUnixDir(const QStringList &tokens, const QString &userName, QUrlInfo *info)
+/*
+    Cursor over a raw listing line. The LIST parsers below tokenize the
+    line in place instead of matching regular expressions against a QString
+    copy of it; the only allocations left are the strings stored in the
+    QUrlInfo.
+*/
+struct QFtpListCursor
+{
+    QFtpListCursor(const char *begin, const char *end) : p(begin), end(end) {}
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t'; }
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // Skips whitespace; returns false if there was none.
+    bool skipSpaces()
+    {
+        const char *start = p;
+        while (p < end && isSpace(*p))
+            ++p;
+        return p != start;
+    }
+
+    // Reads a run of non-whitespace characters.
+    bool token(const char **begin, int *length)
+    {
+        *begin = p;
+        while (p < end && !isSpace(*p))
+            ++p;
+        *length = p - *begin;
+        return *length > 0;
+    }
+
+    // Reads a run of digits.
+    bool number(qint64 *value, int *digits = 0)
+    {
+        const char *start = p;
+        qint64 v = 0;
+        while (p < end && isDigit(*p))
+            v = v * 10 + (*p++ - '0');
+        if (digits)
+            *digits = p - start;
+        *value = v;
+        return p != start;
+    }
+
+    bool expect(char c)
+    {
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    const char *p;
+    const char *end;
+};
+
+static int _q_monthFromName(const char *name, int length)
+{
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+    if (length != 3)
+        return 0;
+    const char c0 = name[0] | 0x20, c1 = name[1] | 0x20, c2 = name[2] | 0x20;
+    for (int m = 0; m < 12; ++m) {
+        if (months[3 * m] == c0 && months[3 * m + 1] == c1 && months[3 * m + 2] == c2)
+            return m + 1;
+    }
+    return 0;
+}
+
+static bool _q_parseUnixDir(QFtpListCursor &c, const QString &userName, QUrlInfo *info)
 {
-    // Unix style, 7 + 1 entries
+    // Unix style
     // -rw-r--r--    1 ftp      ftp      17358091 Aug 10  2004 qt-x11-free-3.3.3.tar.gz
     // drwxr-xr-x    3 ftp      ftp          4096 Apr 14  2000 compiled-examples
     // lrwxrwxrwx    1 ftp      ftp             9 Oct 29  2005 qtscape -> qtmozilla
-    if (tokens.size() != 8)
-        return;
+    if (c.end - c.p < 10)
+        return false;
+    const char first = *c.p;
+    if (first != '-' && first != 'd' && first != 'l')
+        return false;
+    const char *perm = c.p + 1;
+    for (int i = 0; i < 9; ++i) {
+        const char ch = perm[i] | 0x20;
+        if (perm[i] != '-' && (ch < 'a' || ch > 'z'))
+            return false;
+    }
+    c.p += 10;
+
+    qint64 links, size;
+    const char *owner, *group, *month, *day, *yearOrTime;
+    int ownerLength, groupLength, monthLength, dayLength, yearOrTimeLength;
+    if (!c.skipSpaces() || !c.number(&links) || !c.skipSpaces()
+        || !c.token(&owner, &ownerLength) || !c.skipSpaces()
+        || !c.token(&group, &groupLength) || !c.skipSpaces()
+        || !c.number(&size) || !c.skipSpaces()
+        || !c.token(&month, &monthLength) || !c.skipSpaces()
+        || !c.token(&day, &dayLength) || !c.skipSpaces()
+        || !c.token(&yearOrTime, &yearOrTimeLength) || !c.skipSpaces()
+        || c.p >= c.end)
+        return false;
+    Q_UNUSED(links);
 
-    char first = tokens.at(1).at(0).toLatin1();
     if (first == 'd') {
         info->setDir(true);
         info->setFile(false);
@@ -495,94 +670,120 @@ static void _q_parseUnixDir(const QStringList &tokens, const QString &userName,
         info->setDir(false);
         info->setFile(true);
         info->setSymLink(false);
-    } else if (first == 'l') {
+    } else {
         info->setDir(true);
         info->setFile(false);
         info->setSymLink(true);
     }
 
     // Resolve filename
-    QString name = tokens.at(7);
-    if (info->isSymLink()) {
-        int linkPos = name.indexOf(QLatin1String(" ->"));
-        if (linkPos != -1)
-            name.resize(linkPos);
+    const char *nameEnd = c.end;
+    if (first == 'l') {
+        for (const char *s = c.p; s + 2 < c.end; ++s) {
+            if (s[0] == ' ' && s[1] == '-' && s[2] == '>') {
+                nameEnd = s;
+                break;
+            }
+        }
     }
-    info->setName(name);
+    info->setName(QString::fromLatin1(c.p, nameEnd - c.p));
 
     // Resolve owner & group
-    info->setOwner(tokens.at(3));
-    info->setGroup(tokens.at(4));
+    const QString ownerName = QString::fromLatin1(owner, ownerLength);
+    info->setOwner(ownerName);
+    info->setGroup(QString::fromLatin1(group, groupLength));
 
     // Resolve size
-    info->setSize(tokens.at(5).toLongLong());
-
-    QStringList formats;
-    formats << QLatin1String("MMM dd  yyyy") << QLatin1String("MMM dd hh:mm") << QLatin1String("MMM  d  yyyy")
-            << QLatin1String("MMM  d hh:mm") << QLatin1String("MMM  d yyyy") << QLatin1String("MMM dd yyyy");
-
-    QString dateString = tokens.at(6);
-    dateString[0] = dateString[0].toUpper();
-
-    // Resolve the modification date by parsing all possible formats
-    QDateTime dateTime;
-    int n = 0;
-#ifndef QT_NO_DATESTRING
-    do {
-        dateTime = QLocale::c().toDateTime(dateString, formats.at(n++));
-    }  while (n < formats.size() && (!dateTime.isValid()));
-#endif
-
-    if (n == 2 || n == 4) {
-        // Guess the year.
-        dateTime.setDate(QDate(QDate::currentDate().year(),
-                               dateTime.date().month(),
-                               dateTime.date().day()));
-        _q_fixupDateTime(&dateTime);
+    info->setSize(size);
+
+    // Resolve the modification date: "Mmm dd yyyy" or "Mmm dd hh:mm"
+    const int m = _q_monthFromName(month, monthLength);
+    QFtpListCursor dayCursor(day, day + dayLength);
+    qint64 d;
+    if (m && dayCursor.number(&d) && dayCursor.p == dayCursor.end) {
+        QFtpListCursor yt(yearOrTime, yearOrTime + yearOrTimeLength);
+        qint64 yearOrHour, minute;
+        int digits;
+        if (yt.number(&yearOrHour, &digits)) {
+            if (yt.p == yt.end && digits == 4) {
+                QDateTime dateTime(QDate(yearOrHour, m, d), QTime(0, 0));
+                if (dateTime.isValid())
+                    info->setLastModified(dateTime);
+            } else if (yt.expect(':') && yt.number(&minute) && yt.p == yt.end) {
+                // Guess the year.
+                QDateTime dateTime(QDate(QDate::currentDate().year(), m, d), QTime(yearOrHour, minute));
+                if (dateTime.isValid()) {
+                    _q_fixupDateTime(&dateTime);
+                    info->setLastModified(dateTime);
+                }
+            }
+        }
     }
-    if (dateTime.isValid())
-        info->setLastModified(dateTime);
 
     // Resolve permissions
     int permissions = 0;
-    QString p = tokens.at(2);
-    permissions |= (p[0] == QLatin1Char('r') ? QUrlInfo::ReadOwner : 0);
-    permissions |= (p[1] == QLatin1Char('w') ? QUrlInfo::WriteOwner : 0);
-    permissions |= (p[2] == QLatin1Char('x') ? QUrlInfo::ExeOwner : 0);
-    permissions |= (p[3] == QLatin1Char('r') ? QUrlInfo::ReadGroup : 0);
-    permissions |= (p[4] == QLatin1Char('w') ? QUrlInfo::WriteGroup : 0);
-    permissions |= (p[5] == QLatin1Char('x') ? QUrlInfo::ExeGroup : 0);
-    permissions |= (p[6] == QLatin1Char('r') ? QUrlInfo::ReadOther : 0);
-    permissions |= (p[7] == QLatin1Char('w') ? QUrlInfo::WriteOther : 0);
-    permissions |= (p[8] == QLatin1Char('x') ? QUrlInfo::ExeOther : 0);
+    permissions |= (perm[0] == 'r' ? QUrlInfo::ReadOwner : 0);
+    permissions |= (perm[1] == 'w' ? QUrlInfo::WriteOwner : 0);
+    permissions |= (perm[2] == 'x' ? QUrlInfo::ExeOwner : 0);
+    permissions |= (perm[3] == 'r' ? QUrlInfo::ReadGroup : 0);
+    permissions |= (perm[4] == 'w' ? QUrlInfo::WriteGroup : 0);
+    permissions |= (perm[5] == 'x' ? QUrlInfo::ExeGroup : 0);
+    permissions |= (perm[6] == 'r' ? QUrlInfo::ReadOther : 0);
+    permissions |= (perm[7] == 'w' ? QUrlInfo::WriteOther : 0);
+    permissions |= (perm[8] == 'x' ? QUrlInfo::ExeOther : 0);
     info->setPermissions(permissions);
 
-    bool isOwner = info->owner() == userName;
+    bool isOwner = ownerName == userName;
     info->setReadable((permissions & QUrlInfo::ReadOther) || ((permissions & QUrlInfo::ReadOwner) && isOwner));
     info->setWritable((permissions & QUrlInfo::WriteOther) || ((permissions & QUrlInfo::WriteOwner) && isOwner));
+    return true;
 }
 
-static void _q_parseDosDir(const QStringList &tokens, const QString &userName, QUrlInfo *info)
+static bool _q_parseDosDir(QFtpListCursor &c, const QString &userName, QUrlInfo *info)
 {
-    // DOS style, 3 + 1 entries
+    // DOS style
     // 01-16-02  11:14AM       <DIR>          epsgroup
     // 06-05-03  03:19PM                 1973 readme.txt
-    if (tokens.size() != 4)
-        return;
-
     Q_UNUSED(userName);
 
-    QString name = tokens.at(3);
-    info->setName(name);
-    info->setSymLink(name.toLower().endsWith(QLatin1String(".lnk")));
+    qint64 month, day, year, hour, minute;
+    int yearDigits, digits;
+    if (!c.number(&month, &digits) || digits != 2 || !c.expect('-')
+        || !c.number(&day, &digits) || digits != 2 || !c.expect('-')
+        || !c.number(&year, &yearDigits) || yearDigits > 4 || yearDigits < 2
+        || !c.expect(' ') || !c.expect(' ')
+        || !c.number(&hour, &digits) || digits != 2 || !c.expect(':')
+        || !c.number(&minute, &digits) || digits != 2)
+        return false;
+    const bool pm = c.expect('P');
+    if ((!pm && !c.expect('A')) || !c.expect('M'))
+        return false;
+
+    bool isDir = false;
+    qint64 size = 0;
+    if (!c.skipSpaces())
+        return false;
+    if (c.end - c.p >= 5 && qstrncmp(c.p, "<DIR>", 5) == 0) {
+        c.p += 5;
+        isDir = true;
+    } else if (!c.number(&size)) {
+        return false;
+    }
+    if (!c.skipSpaces() || c.p >= c.end)
+        return false;
+
+    const char *name = c.p;
+    const int nameLength = c.end - c.p;
+    info->setName(QString::fromLatin1(name, nameLength));
+    info->setSymLink(nameLength >= 4 && qstrnicmp(name + nameLength - 4, ".lnk", 4) == 0);
 
-    if (tokens.at(2) == QLatin1String("<DIR>")) {
+    if (isDir) {
         info->setFile(false);
         info->setDir(true);
     } else {
         info->setFile(true);
         info->setDir(false);
-        info->setSize(tokens.at(2).toLongLong());
+        info->setSize(size);
     }
 
     // Note: We cannot use QFileInfo; permissions are for the server-side
@@ -590,29 +791,26 @@ static void _q_parseDosDir(const QStringList &tokens, const QString &userName, Q
     int permissions = QUrlInfo::ReadOwner | QUrlInfo::WriteOwner
                       | QUrlInfo::ReadGroup | QUrlInfo::WriteGroup
                       | QUrlInfo::ReadOther | QUrlInfo::WriteOther;
-    QString ext;
-    int extIndex = name.lastIndexOf(QLatin1Char('.'));
-    if (extIndex != -1)
-        ext = name.mid(extIndex + 1);
-    if (ext == QLatin1String("exe") || ext == QLatin1String("bat") || ext == QLatin1String("com"))
+    const char *ext = name + nameLength;
+    while (ext > name && ext[-1] != '.')
+        --ext;
+    const int extLength = name + nameLength - ext;
+    if (ext > name && extLength == 3
+        && (qstrncmp(ext, "exe", 3) == 0 || qstrncmp(ext, "bat", 3) == 0 || qstrncmp(ext, "com", 3) == 0))
         permissions |= QUrlInfo::ExeOwner | QUrlInfo::ExeGroup | QUrlInfo::ExeOther;
     info->setPermissions(permissions);
 
     info->setReadable(true);
     info->setWritable(info->isFile());
 
-    QDateTime dateTime;
-#ifndef QT_NO_DATESTRING
-    dateTime = QLocale::c().toDateTime(tokens.at(1), QLatin1String("MM-dd-yy  hh:mmAP"));
-    if (dateTime.date().year() < 1971) {
-        dateTime.setDate(QDate(dateTime.date().year() + 100,
-                               dateTime.date().month(),
-                               dateTime.date().day()));
+    if (yearDigits == 2) {
+        year += 1900;
+        if (year < 1971)
+            year += 100;
     }
-#endif
-
-    info->setLastModified(dateTime);
-
+    hour = hour % 12 + (pm ? 12 : 0);
+    info->setLastModified(QDateTime(QDate(year, month, day), QTime(hour, minute)));
+    return true;
 }
 
 bool QFtpDTP::parseDir(const QByteArray &buffer, const QString &userName, QUrlInfo *info)
@@ -620,31 +818,178 @@ bool QFtpDTP::parseDir(const QByteArray &buffer, const QString &userName, QUrlIn
     if (buffer.isEmpty())
         return false;
 
-    QString bufferStr = QString::fromLatin1(buffer).trimmed();
+    // trim the line in place
+    const char *begin = buffer.constData();
+    const char *end = begin + buffer.size();
+    while (begin < end && (QFtpListCursor::isSpace(*begin) || *begin == '\r' || *begin == '\n'))
+        ++begin;
+    while (end > begin && (QFtpListCursor::isSpace(end[-1]) || end[-1] == '\r' || end[-1] == '\n'))
+        --end;
+    if (begin == end)
+        return false;
+
+    // DOS style listings start with a digit, Unix style ones never do
+    QFtpListCursor cursor(begin, end);
+    if (QFtpListCursor::isDigit(*begin))
+        return _q_parseDosDir(cursor, userName, info);
+    return _q_parseUnixDir(cursor, userName, info);
+}
 
-    // Unix style FTP servers
-    QRegExp unixPattern(QLatin1String("^([\\-dl])([a-zA-Z\\-]{9,9})\\s+\\d+\\s+(\\S*)\\s+"
-                                      "(\\S*)\\s+(\\d+)\\s+(\\S+\\s+\\S+\\s+\\S+)\\s+(\\S.*)"));
-    if (unixPattern.indexIn(bufferStr) == 0) {
-        _q_parseUnixDir(unixPattern.capturedTexts(), userName, info);
-        return true;
+static inline bool _q_mlsdFactIs(const char *key, int keyLength, const char *name)
+{
+    return int(qstrlen(name)) == keyLength && qstrnicmp(key, name, keyLength) == 0;
+}
+
+static qint64 _q_mlsdNumber(const char *begin, const char *end, int base = 10)
+{
+    qint64 value = 0;
+    for (const char *c = begin; c < end; ++c) {
+        if (*c < '0' || *c >= '0' + base)
+            return -1;
+        value = value * base + (*c - '0');
     }
+    return begin < end ? value : -1;
+}
 
-    // DOS style FTP servers
-    QRegExp dosPattern(QLatin1String("^(\\d\\d-\\d\\d-\\d\\d\\d?\\d?\\ \\ \\d\\d:\\d\\d[AP]M)\\s+"
-                                     "(<DIR>|\\d+)\\s+(\\S.*)$"));
-    if (dosPattern.indexIn(bufferStr) == 0) {
-        _q_parseDosDir(dosPattern.capturedTexts(), userName, info);
-        return true;
+/*
+    Parses one entry of a MLSD listing (RFC 3659, section 7). Unlike LIST,
+    the format is standardized: a list of "fact=value;" pairs followed by a
+    single space and the entry name, with times always given in UTC.
+
+    type=file;size=17358091;modify=20040810120000;perm=adfrw; app.zip
+
+    The scanner walks the raw line once and does not allocate anything but
+    the name. Returns false for entries that should not be reported (the
+    "cdir" and "pdir" entries, and malformed lines).
+*/
+bool QFtpDTP::parseMlsdLine(const QByteArray &buffer, QUrlInfo *info)
+{
+    const char *p = buffer.constData();
+    const char *end = p + buffer.size();
+    while (end > p && (end[-1] == '\n' || end[-1] == '\r'))
+        --end;
+    const char *nameStart = static_cast<const char *>(memchr(p, ' ', end - p));
+    if (!nameStart || nameStart + 1 >= end)
+        return false;
+
+    bool haveType = false;
+    bool haveMode = false;
+    int permissions = 0;
+    bool readable = false;
+    bool writable = false;
+    QString owner;
+    QString group;
+
+    while (p < nameStart) {
+        const char *factEnd = static_cast<const char *>(memchr(p, ';', nameStart - p));
+        if (!factEnd)
+            factEnd = nameStart;
+        const char *eq = static_cast<const char *>(memchr(p, '=', factEnd - p));
+        if (eq) {
+            const char *key = p;
+            const int keyLength = eq - p;
+            const char *value = eq + 1;
+            const int valueLength = factEnd - value;
+
+            if (_q_mlsdFactIs(key, keyLength, "type")) {
+                haveType = true;
+                if (_q_mlsdFactIs(value, valueLength, "cdir") || _q_mlsdFactIs(value, valueLength, "pdir")) {
+                    return false;
+                } else if (_q_mlsdFactIs(value, valueLength, "dir")) {
+                    info->setDir(true);
+                    info->setFile(false);
+                    info->setSymLink(false);
+                } else if (valueLength > 13 && qstrnicmp(value, "OS.unix=slink", 13) == 0) {
+                    // "type=OS.unix=slink:/target" as sent by vsftpd and proftpd;
+                    // QFtp reports links the same way the LIST parser does
+                    info->setDir(true);
+                    info->setFile(false);
+                    info->setSymLink(true);
+                } else {
+                    info->setDir(false);
+                    info->setFile(true);
+                    info->setSymLink(false);
+                }
+            } else if (_q_mlsdFactIs(key, keyLength, "size") || _q_mlsdFactIs(key, keyLength, "sizd")) {
+                qint64 size = _q_mlsdNumber(value, factEnd);
+                if (size >= 0)
+                    info->setSize(size);
+            } else if (_q_mlsdFactIs(key, keyLength, "modify")) {
+                // YYYYMMDDHHMMSS[.sss], always UTC
+                if (valueLength >= 14) {
+                    QDate date(_q_mlsdNumber(value, value + 4),
+                               _q_mlsdNumber(value + 4, value + 6),
+                               _q_mlsdNumber(value + 6, value + 8));
+                    QTime time(_q_mlsdNumber(value + 8, value + 10),
+                               _q_mlsdNumber(value + 10, value + 12),
+                               _q_mlsdNumber(value + 12, value + 14));
+                    QDateTime dateTime(date, time, Qt::UTC);
+                    if (dateTime.isValid())
+                        info->setLastModified(dateTime);
+                }
+            } else if (_q_mlsdFactIs(key, keyLength, "perm")) {
+                for (const char *c = value; c < factEnd; ++c) {
+                    switch (*c | 0x20) {
+                    case 'r': // retrieve
+                    case 'l': // list
+                        readable = true;
+                        permissions |= QUrlInfo::ReadOwner;
+                        break;
+                    case 'e': // enter
+                        permissions |= QUrlInfo::ExeOwner;
+                        break;
+                    case 'a': // append
+                    case 'c': // create
+                    case 'm': // make directory
+                    case 'w': // store
+                        writable = true;
+                        permissions |= QUrlInfo::WriteOwner;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            } else if (_q_mlsdFactIs(key, keyLength, "unix.mode")) {
+                qint64 mode = _q_mlsdNumber(value, factEnd, 8);
+                if (mode >= 0) {
+                    haveMode = true;
+                    permissions = int(mode & 0777);
+                }
+            } else if (_q_mlsdFactIs(key, keyLength, "unix.owner")) {
+                owner = QString::fromUtf8(value, valueLength);
+            } else if (_q_mlsdFactIs(key, keyLength, "unix.group")) {
+                group = QString::fromUtf8(value, valueLength);
+            }
+            // "unique" identifies the file across renames; QUrlInfo has no
+            // slot for it, so it is recognised and skipped like any other
+            // unknown fact.
+        }
+        p = factEnd + 1;
     }
 
-    // Unsupported
-    return false;
+    if (!haveType)
+        return false;
+
+    info->setName(QString::fromUtf8(nameStart + 1, end - nameStart - 1));
+    info->setOwner(owner);
+    info->setGroup(group);
+    if (haveMode) {
+        // the perm fact is relative to the logged in user, UNIX.mode is not;
+        // prefer perm for readable/writable when the server sent both
+        if (!readable && !writable) {
+            readable = permissions & (QUrlInfo::ReadOwner | QUrlInfo::ReadOther);
+            writable = permissions & (QUrlInfo::WriteOwner | QUrlInfo::WriteOther);
+        }
+    }
+    info->setPermissions(permissions);
+    info->setReadable(readable);
+    info->setWritable(writable);
+    return true;
 }
 
 void QFtpDTP::socketConnected()
 {
-    bytesDone = 0;
+    bytesDone = bytesOffset;
 #if defined(QFTPDTP_DEBUG)
     qDebug("QFtpDTP::connectState(CsConnected)");
 #endif
@@ -671,15 +1016,29 @@ void QFtpDTP::socketReadyRead()
         return;
     }
 
-    if (pi->currentCommand().startsWith(QLatin1String("LIST"))) {
+    const bool mlsd = pi->currentCommand().startsWith("MLSD");
+    if (mlsd || pi->currentCommand().startsWith("LIST")) {
+        if (listStopped) {
+            // the caller has seen what it was looking for
+            socket->readAll();
+            return;
+        }
         while (socket->canReadLine()) {
             QUrlInfo i;
             QByteArray line = socket->readLine();
 #if defined(QFTPDTP_DEBUG)
             qDebug("QFtpDTP read (list): '%s'", line.constData());
 #endif
-            if (parseDir(line, QLatin1String(""), &i)) {
-                emit listInfo(i);
+            if (mlsd ? parseMlsdLine(line, &i) : parseDir(line, QLatin1String(""), &i)) {
+                if (listOptions.batched) {
+                    addListEntry(i);
+                    if (listStopped) {
+                        socket->readAll();
+                        return;
+                    }
+                } else {
+                    emit listInfo(i);
+                }
             } else {
                 // some FTP servers don't return a 550 if the file or directory
                 // does not exist, but rather write a text to the data socket
@@ -745,6 +1104,8 @@ void QFtpDTP::socketConnectionClosed()
     }
 
     bytesFromSocket = socket->readAll();
+    if (listOptions.batched)
+        flushListEntries();
 #if defined(QFTPDTP_DEBUG)
     qDebug("QFtpDTP::connectState(CsClosed)");
 #endif
@@ -793,7 +1154,7 @@ QFtpPI::QFtpPI(QObject *parent) :
     dtp(this),
     commandSocket(0),
     state(Begin), abortState(None),
-    currentCmd(QString()),
+    currentCmd(QByteArray()),
     waitForDtpToConnect(false),
     waitForDtpToClose(false)
 {
@@ -815,6 +1176,7 @@ QFtpPI::QFtpPI(QObject *parent) :
 
 void QFtpPI::connectToHost(const QString &host, quint16 port)
 {
+    features.clear();
     emit connectState(QFtp::HostLookup);
 #ifndef QT_NO_BEARERMANAGEMENT
     //copy network session down to the socket & DTP
@@ -842,7 +1204,8 @@ bool QFtpPI::sendCommands(const QStringList &cmds)
         return true; // there are no pending commands
     }
 
-    pendingCommands = cmds;
+    foreach (const QString &cmd, cmds)
+        pendingCommands.append(cmd.toLatin1());
     startNextCmd();
     return true;
 }
@@ -869,7 +1232,7 @@ void QFtpPI::abort()
 #endif
     commandSocket.write("ABOR\r\n", 6);
 
-    if (currentCmd.startsWith(QLatin1String("STOR ")))
+    if (currentCmd.startsWith("STOR ") || currentCmd.startsWith("APPE "))
         dtp.abortConnection();
 }
 
@@ -925,7 +1288,7 @@ void QFtpPI::readyRead()
 
     while (commandSocket.canReadLine()) {
         // read line with respect to line continuation
-        QString line = QString::fromLatin1(commandSocket.readLine());
+        QByteArray line = commandSocket.readLine();
         if (replyText.isEmpty()) {
             if (line.length() < 3) {
                 // protocol error
@@ -934,41 +1297,68 @@ void QFtpPI::readyRead()
             const int lowerLimit[3] = {1,0,0};
             const int upperLimit[3] = {5,5,9};
             for (int i=0; i<3; i++) {
-                replyCode[i] = line[i].digitValue();
+                replyCode[i] = line.at(i) - '0';
                 if (replyCode[i]<lowerLimit[i] || replyCode[i]>upperLimit[i]) {
                     // protocol error
                     return;
                 }
             }
         }
-        QString endOfMultiLine;
-        endOfMultiLine[0] = '0' + replyCode[0];
-        endOfMultiLine[1] = '0' + replyCode[1];
-        endOfMultiLine[2] = '0' + replyCode[2];
-        endOfMultiLine[3] = QLatin1Char(' ');
-        QString lineCont(endOfMultiLine);
-        lineCont[3] = QLatin1Char('-');
-        QString lineLeft4 = line.left(4);
-
-        while (lineLeft4 != endOfMultiLine) {
-            if (lineLeft4 == lineCont)
-                replyText += line.mid(4); // strip 'xyz-'
+        // 'xyz ' ends the reply, 'xyz-' continues it; both share the code
+        const char endOfMultiLine[4] = {
+            char('0' + replyCode[0]), char('0' + replyCode[1]), char('0' + replyCode[2]), ' '
+        };
+
+        while (line.length() < 4 || memcmp(line.constData(), endOfMultiLine, 4) != 0) {
+            if (line.length() >= 4 && line.at(3) == '-' && memcmp(line.constData(), endOfMultiLine, 3) == 0)
+                replyText.append(line.constData() + 4, line.length() - 4); // strip 'xyz-'
             else
                 replyText += line;
             if (!commandSocket.canReadLine())
                 return;
-            line = QString::fromLatin1(commandSocket.readLine());
-            lineLeft4 = line.left(4);
+            line = commandSocket.readLine();
         }
-        replyText += line.mid(4); // strip reply code 'xyz '
-        if (replyText.endsWith(QLatin1String("\r\n")))
+        replyText.append(line.constData() + 4, line.length() - 4); // strip reply code 'xyz '
+        if (replyText.endsWith("\r\n"))
             replyText.chop(2);
 
         if (processReply())
-            replyText = QLatin1String("");
+            replyText.clear();
     }
 }
 
+/*
+  Finds the first run of six comma separated numbers in the 227 reply \a text
+  and stores them in \a numbers. Returns false if there is no such run.
+*/
+static bool _q_parsePasvNumbers(const QByteArray &text, uint numbers[6])
+{
+    const char *begin = text.constData();
+    const char *end = begin + text.size();
+    for (const char *start = begin; start < end; ++start) {
+        if (!QFtpListCursor::isDigit(*start))
+            continue;
+        const char *p = start;
+        int i = 0;
+        for (; i < 6; ++i) {
+            if (i > 0) {
+                if (p == end || *p != ',')
+                    break;
+                ++p;
+            }
+            if (p == end || !QFtpListCursor::isDigit(*p))
+                break;
+            uint value = 0;
+            while (p != end && QFtpListCursor::isDigit(*p))
+                value = value * 10 + uint(*p++ - '0');
+            numbers[i] = value;
+        }
+        if (i == 6)
+            return true;
+    }
+    return false;
+}
+
 /*
   Process a reply from the FTP server.
 
@@ -980,7 +1370,7 @@ bool QFtpPI::processReply()
 #if defined(QFTPPI_DEBUG)
 //    qDebug("QFtpPI state: %d [processReply() begin]", state);
     if (replyText.length() < 400)
-        qDebug("QFtpPI recv: %d %s", 100*replyCode[0]+10*replyCode[1]+replyCode[2], replyText.toLatin1().constData());
+        qDebug("QFtpPI recv: %d %s", 100*replyCode[0]+10*replyCode[1]+replyCode[2], replyText.constData());
     else
         qDebug("QFtpPI recv: %d (text skipped)", 100*replyCode[0]+10*replyCode[1]+replyCode[2]);
 #endif
@@ -989,7 +1379,7 @@ bool QFtpPI::processReply()
 
     // process 226 replies ("Closing Data Connection") only when the data
     // connection is really closed to avoid short reads of the DTP
-    if (replyCodeInt == 226 || (replyCodeInt == 250 && currentCmd.startsWith(QLatin1String("RETR")))) {
+    if (replyCodeInt == 226 || (replyCodeInt == 250 && currentCmd.startsWith("RETR"))) {
         if (dtp.state() != QTcpSocket::UnconnectedState) {
             waitForDtpToClose = true;
             return false;
@@ -1049,7 +1439,7 @@ bool QFtpPI::processReply()
 #endif
 
     // special actions on certain replies
-    emit rawFtpReply(replyCodeInt, replyText);
+    emit rawFtpReply(replyCodeInt, QString::fromLatin1(replyText));
     if (rawCommand) {
         rawCommand = false;
     } else if (replyCodeInt == 227) {
@@ -1058,22 +1448,21 @@ bool QFtpPI::processReply()
         // both examples where the parenthesis are used, and where
         // they are missing. We need to scan for the address and host
         // info.
-        QRegExp addrPortPattern(QLatin1String("(\\d+),(\\d+),(\\d+),(\\d+),(\\d+),(\\d+)"));
-        if (addrPortPattern.indexIn(replyText) == -1) {
+        uint hp[6];
+        if (!_q_parsePasvNumbers(replyText, hp)) {
 #if defined(QFTPPI_DEBUG)
             qDebug("QFtp: bad 227 response -- address and port information missing");
 #endif
             // this error should be reported
         } else {
-            QStringList lst = addrPortPattern.capturedTexts();
-            QString host = lst[1] + QLatin1Char('.') + lst[2] + QLatin1Char('.') + lst[3] + QLatin1Char('.') + lst[4];
-            quint16 port = (lst[5].toUInt() << 8) + lst[6].toUInt();
+            QString host = QString::fromLatin1("%1.%2.%3.%4").arg(hp[0]).arg(hp[1]).arg(hp[2]).arg(hp[3]);
+            quint16 port = (hp[4] << 8) + hp[5];
             waitForDtpToConnect = true;
             dtp.connectToHost(host, port);
         }
     } else if (replyCodeInt == 229) {
         // 229 Extended Passive mode OK (|||10982|)
-        int portPos = replyText.indexOf(QLatin1Char('('));
+        int portPos = replyText.indexOf('(');
         if (portPos == -1) {
 #if defined(QFTPPI_DEBUG)
             qDebug("QFtp: bad 229 response -- port information missing");
@@ -1081,8 +1470,8 @@ bool QFtpPI::processReply()
             // this error should be reported
         } else {
             ++portPos;
-            QChar delimiter = replyText.at(portPos);
-            QStringList epsvParameters = replyText.mid(portPos).split(delimiter);
+            char delimiter = replyText.at(portPos);
+            QList<QByteArray> epsvParameters = replyText.mid(portPos).split(delimiter);
 
             waitForDtpToConnect = true;
             dtp.connectToHost(commandSocket.peerAddress().toString(),
@@ -1090,18 +1479,36 @@ bool QFtpPI::processReply()
         }
 
     } else if (replyCodeInt == 230) {
-        if (currentCmd.startsWith(QLatin1String("USER ")) && pendingCommands.count()>0 &&
-            pendingCommands.first().startsWith(QLatin1String("PASS "))) {
+        if (currentCmd.startsWith("USER ") && pendingCommands.count()>0 &&
+            pendingCommands.first().startsWith("PASS ")) {
             // no need to send the PASS -- we are already logged in
             pendingCommands.pop_front();
         }
         // 230 User logged in, proceed.
         emit connectState(QFtp::LoggedIn);
+    } else if (replyCodeInt == 211 && currentCmd.startsWith("FEAT")) {
+        // 211-Features:
+        //  MDTM
+        //  MLST type*;size*;modify*;perm*;unique*;
+        // 211 End
+        // Each feature line starts with a space; only the feature name
+        // itself is kept, the arguments are not needed by QFtp.
+        features.clear();
+        foreach (const QByteArray &feature, replyText.split('\n')) {
+            if (!feature.startsWith(' '))
+                continue;
+            QByteArray name = feature.trimmed();
+            int space = name.indexOf(' ');
+            if (space != -1)
+                name.truncate(space);
+            if (!name.isEmpty())
+                features.append(name.toUpper());
+        }
     } else if (replyCodeInt == 213) {
         // 213 File status.
-        if (currentCmd.startsWith(QLatin1String("SIZE ")))
+        if (currentCmd.startsWith("SIZE "))
             dtp.setBytesTotal(replyText.simplified().toLongLong());
-    } else if (replyCode[0]==1 && currentCmd.startsWith(QLatin1String("STOR "))) {
+    } else if (replyCode[0]==1 && (currentCmd.startsWith("STOR ") || currentCmd.startsWith("APPE "))) {
         dtp.waitForConnection();
         dtp.writeData();
     }
@@ -1128,14 +1535,22 @@ bool QFtpPI::processReply()
         case Failure:
             // If the EPSV or EPRT commands fail, replace them with
             // the old PASV and PORT instead and try again.
-            if (currentCmd.startsWith(QLatin1String("EPSV"))) {
+            if (currentCmd.startsWith("EPSV")) {
                 transferConnectionExtended = false;
-                pendingCommands.prepend(QLatin1String("PASV\r\n"));
-            } else if (currentCmd.startsWith(QLatin1String("EPRT"))) {
+                pendingCommands.prepend(QByteArray("PASV\r\n"));
+            } else if (currentCmd.startsWith("EPRT")) {
                 transferConnectionExtended = false;
-                pendingCommands.prepend(QLatin1String("PORT\r\n"));
+                pendingCommands.prepend(QByteArray("PORT\r\n"));
+            } else if (currentCmd.startsWith("MLSD") && !dataConnectionCmd.isEmpty()) {
+                // The server advertised MLST but refused MLSD for this
+                // path; list it again with LIST over a new data connection.
+                // If MLSD is not implemented at all, stop trying it.
+                if (replyCodeInt == 500 || replyCodeInt == 502)
+                    removeFeature("MLST");
+                pendingCommands.prepend("LIST" + currentCmd.mid(4));
+                pendingCommands.prepend(dataConnectionCmd);
             } else {
-                emit error(QFtp::UnknownError, replyText);
+                emit error(QFtp::UnknownError, QString::fromLatin1(replyText));
             }
             if (state != Waiting) {
                 state = Idle;
@@ -1165,35 +1580,37 @@ bool QFtpPI::startNextCmd()
 #endif
     if (pendingCommands.isEmpty()) {
         currentCmd.clear();
-        emit finished(replyText);
+        emit finished(QString::fromLatin1(replyText));
         return false;
     }
     currentCmd = pendingCommands.first();
+    if (currentCmd.startsWith("PORT") || currentCmd.startsWith("PASV"))
+        dataConnectionCmd = currentCmd;
 
     // PORT and PASV are edited in-place, depending on whether we
     // should try the extended transfer connection commands EPRT and
     // EPSV. The PORT command also triggers setting up a listener, and
     // the address/port arguments are edited in.
     QHostAddress address = commandSocket.localAddress();
-    if (currentCmd.startsWith(QLatin1String("PORT"))) {
+    if (currentCmd.startsWith("PORT")) {
         if ((address.protocol() == QTcpSocket::IPv6Protocol) && transferConnectionExtended) {
             int port = dtp.setupListener(address);
-            currentCmd = QLatin1String("EPRT |");
-            currentCmd += (address.protocol() == QTcpSocket::IPv4Protocol) ? QLatin1Char('1') : QLatin1Char('2');
-            currentCmd += QLatin1Char('|') + address.toString() + QLatin1Char('|') + QString::number(port);
-            currentCmd += QLatin1Char('|');
+            currentCmd = "EPRT |";
+            currentCmd += (address.protocol() == QTcpSocket::IPv4Protocol) ? '1' : '2';
+            currentCmd += '|' + address.toString().toLatin1() + '|' + QByteArray::number(port);
+            currentCmd += '|';
         } else if (address.protocol() == QTcpSocket::IPv4Protocol) {
             int port = dtp.setupListener(address);
-            QString portArg;
+            QByteArray portArg;
             quint32 ip = address.toIPv4Address();
-            portArg += QString::number((ip & 0xff000000) >> 24);
-            portArg += QLatin1Char(',') + QString::number((ip & 0xff0000) >> 16);
-            portArg += QLatin1Char(',') + QString::number((ip & 0xff00) >> 8);
-            portArg += QLatin1Char(',') + QString::number(ip & 0xff);
-            portArg += QLatin1Char(',') + QString::number((port & 0xff00) >> 8);
-            portArg += QLatin1Char(',') + QString::number(port & 0xff);
-
-            currentCmd = QLatin1String("PORT ");
+            portArg += QByteArray::number((ip & 0xff000000) >> 24);
+            portArg += ',' + QByteArray::number((ip & 0xff0000) >> 16);
+            portArg += ',' + QByteArray::number((ip & 0xff00) >> 8);
+            portArg += ',' + QByteArray::number(ip & 0xff);
+            portArg += ',' + QByteArray::number((port & 0xff00) >> 8);
+            portArg += ',' + QByteArray::number(port & 0xff);
+
+            currentCmd = "PORT ";
             currentCmd += portArg;
         } else {
             // No IPv6 connection can be set up with the PORT
@@ -1201,18 +1618,18 @@ bool QFtpPI::startNextCmd()
             return false;
         }
 
-        currentCmd += QLatin1String("\r\n");
-    } else if (currentCmd.startsWith(QLatin1String("PASV"))) {
+        currentCmd += "\r\n";
+    } else if (currentCmd.startsWith("PASV")) {
         if ((address.protocol() == QTcpSocket::IPv6Protocol) && transferConnectionExtended)
-            currentCmd = QLatin1String("EPSV\r\n");
+            currentCmd = "EPSV\r\n";
     }
 
     pendingCommands.pop_front();
 #if defined(QFTPPI_DEBUG)
-    qDebug("QFtpPI send: %s", currentCmd.left(currentCmd.length()-2).toLatin1().constData());
+    qDebug("QFtpPI send: %s", currentCmd.left(currentCmd.length()-2).constData());
 #endif
     state = Waiting;
-    commandSocket.write(currentCmd.toLatin1());
+    commandSocket.write(currentCmd);
     return true;
 }
 
@@ -1223,7 +1640,7 @@ void QFtpPI::dtpConnectState(int s)
             if (waitForDtpToClose) {
                 // there is an unprocessed reply
                 if (processReply())
-                    replyText = QLatin1String("");
+                    replyText.clear();
                 else
                     return;
             }
@@ -1428,6 +1845,8 @@ QFtp::QFtp(QObject *parent)
             SIGNAL(dataTransferProgress(qint64,qint64)));
     connect(&d->pi.dtp, SIGNAL(listInfo(QUrlInfo)),
             SIGNAL(listInfo(QUrlInfo)));
+    connect(&d->pi.dtp, SIGNAL(listInfos(QVector<QUrlInfo>)),
+            SIGNAL(listInfos(QVector<QUrlInfo>)));
 }
 
 /*!
@@ -1542,6 +1961,17 @@ QFtp::QFtp(QObject *parent)
     \sa list()
 */
 
+/*!
+    \fn void QFtp::listInfos(const QVector<QUrlInfo> &entries);
+
+    This signal is emitted with the directory entries found by a list()
+    command that was given a filter, a stop predicate or a batch size.
+    Depending on the batch size it is emitted one or more times before
+    the command's commandFinished() signal.
+
+    \sa list()
+*/
+
 /*!
     \fn void QFtp::commandStarted(int id)
 
@@ -1673,6 +2103,7 @@ int QFtp::login(const QString &user, const QString &password)
     QStringList cmds;
     cmds << (QLatin1String("USER ") + (user.isNull() ? QLatin1String("anonymous") : user) + QLatin1String("\r\n"));
     cmds << (QLatin1String("PASS ") + (password.isNull() ? QLatin1String("anonymous@") : password) + QLatin1String("\r\n"));
+    cmds << QLatin1String("FEAT\r\n");
     return d->addCommand(new QFtpCommand(Login, cmds));
 }
 
@@ -1732,6 +2163,11 @@ int QFtp::setProxy(const QString &host, quint16 port)
 
     The listInfo() signal is emitted for each directory entry found.
 
+    If the server advertised MLST in its reply to FEAT (sent as part of
+    login()), the listing is requested with MLSD, whose machine-readable
+    format carries exact sizes and UTC modification times. QFtp falls back
+    to LIST if the server refuses MLSD.
+
     The function does not block and returns immediately. The command
     is scheduled, and its execution is performed asynchronously. The
     function returns a unique identifier which is passed by
@@ -1755,6 +2191,37 @@ int QFtp::list(const QString &dir)
     return d->addCommand(new QFtpCommand(List, cmds));
 }
 
+/*!
+    \overload
+
+    Lists the contents of directory \a dir on the FTP server and delivers
+    the entries in bulk through the listInfos() signal instead of one
+    listInfo() signal per entry.
+
+    Only entries for which \a filter returns true are delivered; a null
+    \a filter accepts every entry. Parsing stops at the first entry for
+    which \a stop returns true (that entry is still subject to \a
+    filter), and the rest of the listing is discarded. If \a batchSize is
+    greater than 0, listInfos() is emitted each time that many entries
+    have been collected; otherwise it is emitted once, when the listing
+    is complete.
+
+    The predicates are called from within QFtp's socket handling and must
+    not call back into this QFtp object.
+
+    \sa listInfos() commandFinished()
+*/
+int QFtp::list(const QString &dir, const ListPredicate &filter, const ListPredicate &stop, int batchSize)
+{
+    int id = list(dir);
+    QFtpCommand *c = d->pending.last();
+    c->listOptions.batched = true;
+    c->listOptions.batchSize = batchSize;
+    c->listOptions.filter = filter;
+    c->listOptions.stop = stop;
+    return id;
+}
+
 /*!
     Changes the working directory of the server to \a dir.
 
@@ -1815,6 +2282,26 @@ int QFtp::cd(const QString &dir)
     commandFinished()
 */
 int QFtp::get(const QString &file, QIODevice *dev, TransferType type)
+{
+    return get(file, dev, 0, type);
+}
+
+/*!
+    \overload
+
+    Downloads the file \a file from the server, starting \a offset bytes
+    into it. A REST command is sent before the transfer, so the server
+    must support restarting transfers in stream mode (RFC 3659).
+
+    This is used to resume an interrupted download: if \a dev is not 0
+    it should already hold the first \a offset bytes of the file and be
+    positioned at its end, for instance a QFile opened with
+    QIODevice::Append. The progress reported by dataTransferProgress()
+    includes the \a offset bytes that were not transferred again.
+
+    \sa put() dataTransferProgress()
+*/
+int QFtp::get(const QString &file, QIODevice *dev, qint64 offset, TransferType type)
 {
     QStringList cmds;
     if (type == Binary)
@@ -1823,8 +2310,12 @@ int QFtp::get(const QString &file, QIODevice *dev, TransferType type)
         cmds << QLatin1String("TYPE A\r\n");
     cmds << QLatin1String("SIZE ") + file + QLatin1String("\r\n");
     cmds << QLatin1String(d->transferMode == Passive ? "PASV\r\n" : "PORT\r\n");
+    if (offset > 0)
+        cmds << QLatin1String("REST ") + QString::number(offset) + QLatin1String("\r\n");
     cmds << QLatin1String("RETR ") + file + QLatin1String("\r\n");
-    return d->addCommand(new QFtpCommand(Get, cmds, dev));
+    QFtpCommand *c = new QFtpCommand(Get, cmds, dev);
+    c->offset = qMax(offset, qint64(0));
+    return d->addCommand(c);
 }
 
 /*!
@@ -1880,6 +2371,27 @@ int QFtp::put(const QByteArray &data, const QString &file, TransferType type)
 */
 int QFtp::put(QIODevice *dev, const QString &file, TransferType type)
 {
+    return put(dev, file, 0, type);
+}
+
+/*!
+    \overload
+
+    Resumes an upload: the data of \a dev from \a offset onwards is
+    written to the file called \a file on the server, which is expected
+    to already contain the first \a offset bytes. Random-access devices
+    are seeked to \a offset when the command starts; sequential devices
+    must already be positioned there.
+
+    If the server announced REST in its FEAT reply the transfer is sent as
+    REST followed by STOR, otherwise APPE is used to append the tail to the
+    partial file.
+
+    \sa get() dataTransferProgress()
+*/
+int QFtp::put(QIODevice *dev, const QString &file, qint64 offset, TransferType type)
+{
+    offset = qMax(offset, qint64(0));
     QStringList cmds;
     if (type == Binary)
         cmds << QLatin1String("TYPE I\r\n");
@@ -1887,9 +2399,15 @@ int QFtp::put(QIODevice *dev, const QString &file, TransferType type)
         cmds << QLatin1String("TYPE A\r\n");
     cmds << QLatin1String(d->transferMode == Passive ? "PASV\r\n" : "PORT\r\n");
     if (!dev->isSequential())
-        cmds << QLatin1String("ALLO ") + QString::number(dev->size()) + QLatin1String("\r\n");
+        cmds << QLatin1String("ALLO ") + QString::number(dev->size() - offset) + QLatin1String("\r\n");
+    // REST must immediately precede the STOR; it is dropped again in favour
+    // of APPE if the server turns out not to support it
+    if (offset > 0)
+        cmds << QLatin1String("REST ") + QString::number(offset) + QLatin1String("\r\n");
     cmds << QLatin1String("STOR ") + file + QLatin1String("\r\n");
-    return d->addCommand(new QFtpCommand(Put, cmds, dev));
+    QFtpCommand *c = new QFtpCommand(Put, cmds, dev);
+    c->offset = offset;
+    return d->addCommand(c);
 }
 
 /*!
@@ -2156,6 +2674,21 @@ QFtp::State QFtp::state() const
     return d->state;
 }
 
+/*!
+    Returns true if the server listed \a feature in its reply to the FEAT
+    command that login() sends; otherwise returns false. Only the feature
+    name is compared, case-insensitively, e.g. "MDTM", "REST" or "XMD5".
+
+    The result is only meaningful once login() has finished. Servers that
+    do not implement FEAT appear to support no features at all.
+
+    \sa login()
+*/
+bool QFtp::hasFeature(const QString &feature) const
+{
+    return d->pi.hasFeature(feature.toLatin1());
+}
+
 /*!
     Returns the last error that occurred. This is useful to find out
     what went wrong when receiving a commandFinished() or a done()
@@ -2231,12 +2764,21 @@ void QFtpPrivate::_q_startNextCommand()
             pi.connectToHost(c->rawCmds[0], c->rawCmds[1].toUInt());
         }
     } else {
+        pi.dtp.setTransferOffset(c->offset);
         if (c->command == QFtp::Put) {
+            if (c->offset > 0 && !pi.hasFeature("REST")) {
+                // Servers without REST STREAM cannot restart a STOR;
+                // append the missing tail to the partial file instead.
+                c->rawCmds.removeAt(c->rawCmds.count() - 2);
+                c->rawCmds.last().replace(0, 4, QLatin1String("APPE"));
+            }
             if (c->is_ba) {
                 pi.dtp.setData(c->data.ba);
                 pi.dtp.setBytesTotal(c->data.ba->size());
             } else if (c->data.dev && (c->data.dev->isOpen() || c->data.dev->open(QIODevice::ReadOnly))) {
                 pi.dtp.setDevice(c->data.dev);
+                if (c->offset > 0 && !c->data.dev->isSequential())
+                    c->data.dev->seek(c->offset);
                 if (c->data.dev->isSequential()) {
                     pi.dtp.setBytesTotal(0);
                     pi.dtp.connect(c->data.dev, SIGNAL(readyRead()), SLOT(dataReadyRead()));
@@ -2249,6 +2791,12 @@ void QFtpPrivate::_q_startNextCommand()
             if (!c->is_ba && c->data.dev) {
                 pi.dtp.setDevice(c->data.dev);
             }
+        } else if (c->command == QFtp::List) {
+            // Use the structured listing if the server supports it. The
+            // LIST command is the last one of the sequence.
+            if (pi.hasFeature("MLST") && c->rawCmds.last().startsWith(QLatin1String("LIST")))
+                c->rawCmds.last().replace(0, 4, QLatin1String("MLSD"));
+            pi.dtp.setListOptions(c->listOptions);
         } else if (c->command == QFtp::Close) {
             state = QFtp::Closing;
             emit q->stateChanged(state);
@@ -2301,10 +2849,13 @@ void QFtpPrivate::_q_piError(int errorCode, const QString &text)
     QFtpCommand *c = pending.first();
 
     // non-fatal errors
-    if (c->command == QFtp::Get && pi.currentCommand().startsWith(QLatin1String("SIZE "))) {
+    if (c->command == QFtp::Get && pi.currentCommand().startsWith("SIZE ")) {
         pi.dtp.setBytesTotal(0);
         return;
-    } else if (c->command==QFtp::Put && pi.currentCommand().startsWith(QLatin1String("ALLO "))) {
+    } else if (c->command==QFtp::Put && pi.currentCommand().startsWith("ALLO ")) {
+        return;
+    } else if (c->command == QFtp::Login && pi.currentCommand().startsWith("FEAT")) {
+        // servers predating RFC 2389 do not know FEAT
         return;
     }
 
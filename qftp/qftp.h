@@ -44,7 +44,9 @@
 
 #include <QtCore/qstring.h>
 #include <QtCore/qobject.h>
+#include <QtCore/qvector.h>
 #include <qurlinfo.h>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 
@@ -104,11 +106,17 @@ public:
     int login(const QString &user = QString(), const QString &password = QString());
     int close();
     int setTransferMode(TransferMode mode);
+    typedef std::function<bool (const QUrlInfo &)> ListPredicate;
+
     int list(const QString &dir = QString());
+    int list(const QString &dir, const ListPredicate &filter,
+             const ListPredicate &stop = ListPredicate(), int batchSize = 0);
     int cd(const QString &dir);
     int get(const QString &file, QIODevice *dev=0, TransferType type = Binary);
+    int get(const QString &file, QIODevice *dev, qint64 offset, TransferType type = Binary);
     int put(const QByteArray &data, const QString &file, TransferType type = Binary);
     int put(QIODevice *dev, const QString &file, TransferType type = Binary);
+    int put(QIODevice *dev, const QString &file, qint64 offset, TransferType type = Binary);
     int remove(const QString &file);
     int mkdir(const QString &dir);
     int rmdir(const QString &dir);
@@ -127,6 +135,7 @@ public:
     void clearPendingCommands();
 
     State state() const;
+    bool hasFeature(const QString &feature) const;
 
     Error error() const;
     QString errorString() const;
@@ -137,6 +146,7 @@ public Q_SLOTS:
 Q_SIGNALS:
     void stateChanged(int);
     void listInfo(const QUrlInfo&);
+    void listInfos(const QVector<QUrlInfo>&);
     void readyRead();
     void dataTransferProgress(qint64, qint64);
     void rawCommandReply(int, const QString&);
@@ -1,7 +1,7 @@
 TEMPLATE = lib
 TARGET = QtFtp
-CONFIG += shared
+CONFIG += shared c++11
 QT = core network
 # Input
-HEADERS += qftp.h qurlinfo.h
-SOURCES += qftp.cpp qurlinfo.cpp
+HEADERS += qftp.h qurlinfo.h qurlinfolist.h
+SOURCES += qftp.cpp qurlinfo.cpp qurlinfolist.cpp
@@ -0,0 +1,166 @@
+/****************************************************************************
+**
+** Copyright (C) 2012 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtNetwork module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qurlinfolist.h"
+
+QT_BEGIN_NAMESPACE
+
+// marks an entry without a valid modification time
+static const qint64 invalidTime = Q_INT64_C(-0x7fffffffffffffff) - 1;
+
+QUrlInfoList::QUrlInfoList()
+{
+    // id 0 is the empty owner/group
+    strings.append(QString());
+    stringIds.insert(QString(), 0);
+}
+
+quint16 QUrlInfoList::intern(const QString &s)
+{
+    QHash<QString, quint16>::const_iterator it = stringIds.constFind(s);
+    if (it != stringIds.constEnd())
+        return it.value();
+    if (strings.size() > 0xffff)
+        return 0;
+    quint16 id = strings.size();
+    strings.append(s);
+    stringIds.insert(s, id);
+    return id;
+}
+
+void QUrlInfoList::append(const QUrlInfo &info)
+{
+    Entry e;
+    const QByteArray name = info.name().toUtf8();
+    e.nameOffset = names.size();
+    e.nameLength = name.size();
+    names.append(name);
+    e.size = info.size();
+    const QDateTime modified = info.lastModified();
+    e.lastModified = modified.isValid() ? modified.toMSecsSinceEpoch() : invalidTime;
+    e.owner = intern(info.owner());
+    e.group = intern(info.group());
+    e.permissions = info.permissions();
+    e.flags = (info.isDir() ? Dir : 0)
+            | (info.isFile() ? File : 0)
+            | (info.isSymLink() ? SymLink : 0)
+            | (info.isWritable() ? Writable : 0)
+            | (info.isReadable() ? Readable : 0)
+            | (info.isExecutable() ? Executable : 0)
+            | (modified.timeSpec() == Qt::UTC ? UtcTime : 0);
+    entries.append(e);
+}
+
+void QUrlInfoList::append(const QVector<QUrlInfo> &infos)
+{
+    entries.reserve(entries.size() + infos.size());
+    foreach (const QUrlInfo &info, infos)
+        append(info);
+}
+
+void QUrlInfoList::reserve(int entryCount, int nameBytes)
+{
+    entries.reserve(entryCount);
+    if (nameBytes > 0)
+        names.reserve(nameBytes);
+}
+
+void QUrlInfoList::clear()
+{
+    entries.clear();
+    names.clear();
+    strings.erase(strings.begin() + 1, strings.end());
+    stringIds.clear();
+    stringIds.insert(QString(), 0);
+}
+
+/*
+    Returns the index of the first entry called \a name, or -1. The name is
+    converted once and compared against the arena without building a
+    QString per entry.
+*/
+int QUrlInfoList::indexOf(const QString &name) const
+{
+    const QByteArray wanted = name.toUtf8();
+    const char *arena = names.constData();
+    for (int i = 0; i < entries.size(); ++i) {
+        const Entry &e = entries.at(i);
+        if (int(e.nameLength) == wanted.size()
+            && memcmp(arena + e.nameOffset, wanted.constData(), e.nameLength) == 0)
+            return i;
+    }
+    return -1;
+}
+
+QString QUrlInfoList::name(int i) const
+{
+    const Entry &e = entries.at(i);
+    return QString::fromUtf8(names.constData() + e.nameOffset, e.nameLength);
+}
+
+QString QUrlInfoList::owner(int i) const
+{
+    return strings.at(entries.at(i).owner);
+}
+
+QString QUrlInfoList::group(int i) const
+{
+    return strings.at(entries.at(i).group);
+}
+
+QDateTime QUrlInfoList::lastModified(int i) const
+{
+    const Entry &e = entries.at(i);
+    if (e.lastModified == invalidTime)
+        return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(e.lastModified, (e.flags & UtcTime) ? Qt::UTC : Qt::LocalTime);
+}
+
+QUrlInfo QUrlInfoList::at(int i) const
+{
+    const Entry &e = entries.at(i);
+    return QUrlInfo(name(i), e.permissions, owner(i), group(i), e.size,
+                    lastModified(i), QDateTime(),
+                    e.flags & Dir, e.flags & File, e.flags & SymLink,
+                    e.flags & Writable, e.flags & Readable, e.flags & Executable);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,126 @@
+/****************************************************************************
+**
+** Copyright (C) 2012 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtNetwork module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QURLINFOLIST_H
+#define QURLINFOLIST_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvector.h>
+#include <qurlinfo.h>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    A directory listing stored as fixed-size records. Names live in one
+    shared UTF-8 arena, owner and group names are interned, the type and
+    access flags are packed into bits and the modification time is kept
+    as milliseconds since the epoch. An entry costs 32 bytes plus its
+    name, against several heap blocks for a QUrlInfo.
+
+    at() rebuilds a QUrlInfo for code that needs one; the per-field
+    accessors do not allocate except for the returned strings.
+*/
+class QUrlInfoList
+{
+public:
+    QUrlInfoList();
+
+    void append(const QUrlInfo &info);
+    void append(const QVector<QUrlInfo> &infos);
+    void reserve(int entryCount, int nameBytes = 0);
+    void clear();
+
+    int count() const { return entries.size(); }
+    bool isEmpty() const { return entries.isEmpty(); }
+
+    int indexOf(const QString &name) const;
+    bool contains(const QString &name) const { return indexOf(name) != -1; }
+
+    QString name(int i) const;
+    QString owner(int i) const;
+    QString group(int i) const;
+    qint64 size(int i) const { return entries.at(i).size; }
+    int permissions(int i) const { return entries.at(i).permissions; }
+    QDateTime lastModified(int i) const;
+    bool isDir(int i) const { return entries.at(i).flags & Dir; }
+    bool isFile(int i) const { return entries.at(i).flags & File; }
+    bool isSymLink(int i) const { return entries.at(i).flags & SymLink; }
+    bool isWritable(int i) const { return entries.at(i).flags & Writable; }
+    bool isReadable(int i) const { return entries.at(i).flags & Readable; }
+    bool isExecutable(int i) const { return entries.at(i).flags & Executable; }
+
+    QUrlInfo at(int i) const;
+
+private:
+    enum Flag {
+        Dir = 0x01,
+        File = 0x02,
+        SymLink = 0x04,
+        Writable = 0x08,
+        Readable = 0x10,
+        Executable = 0x20,
+        UtcTime = 0x40
+    };
+
+    struct Entry {
+        quint32 nameOffset;
+        quint32 nameLength;
+        qint64 size;
+        qint64 lastModified;
+        quint16 owner;
+        quint16 group;
+        quint16 permissions;
+        quint16 flags;
+    };
+
+    quint16 intern(const QString &s);
+
+    QVector<Entry> entries;
+    QByteArray names;
+    QStringList strings;
+    QHash<QString, quint16> stringIds;
+};
+
+QT_END_NAMESPACE
+
+#endif // QURLINFOLIST_H
@@ -0,0 +1,334 @@
+/**
+ ******************************************************************************
+ * @file       asyncftp.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup AsyncFtp
+ * @{
+ * @brief Future based interface to QFtp
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "asyncftp.h"
+#include "logging.h"
+
+FtpFuture::FtpFuture() : d(new state)
+{
+    d->finished = false;
+    d->success = false;
+    d->replyCode = 0;
+}
+
+bool FtpFuture::isFinished() const
+{
+    return d->finished;
+}
+
+bool FtpFuture::isSuccess() const
+{
+    return d->finished && d->success;
+}
+
+QString FtpFuture::errorString() const
+{
+    return d->errorString;
+}
+
+int FtpFuture::replyCode() const
+{
+    return d->replyCode;
+}
+
+QString FtpFuture::replyText() const
+{
+    return d->replyText;
+}
+
+QVariant FtpFuture::value() const
+{
+    return d->value;
+}
+
+void FtpFuture::onFinished(FtpFuture::callback cb) const
+{
+    if(d->finished)
+        cb(*this);
+    else
+        d->callbacks.append(cb);
+}
+
+FtpFuture FtpFuture::then(FtpFuture::continuation next) const
+{
+    FtpPromise promise;
+    onFinished([promise, next](const FtpFuture &result) {
+        next(result).onFinished([promise](const FtpFuture &chained) {
+            promise.finishFrom(chained);
+        });
+    });
+    return promise.future();
+}
+
+FtpFuture FtpFuture::andThen(std::function<FtpFuture ()> next) const
+{
+    return then([next](const FtpFuture &result) {
+        if(!result.isSuccess())
+            return result;
+        return next();
+    });
+}
+
+FtpFuture FtpFuture::succeeded(QVariant value)
+{
+    FtpPromise promise;
+    promise.resolve(value);
+    return promise.future();
+}
+
+FtpFuture FtpFuture::failed(QString errorString)
+{
+    FtpPromise promise;
+    promise.reject(errorString);
+    return promise.future();
+}
+
+// Finishes when all futures have; succeeds if all did, with their values
+// in a QVariantList, otherwise fails with the first error.
+FtpFuture FtpFuture::whenAll(QList<FtpFuture> futures)
+{
+    if(futures.isEmpty())
+        return succeeded(QVariantList());
+    FtpPromise promise;
+    QSharedPointer<int> remaining(new int(futures.count()));
+    QSharedPointer<QVariantList> values(new QVariantList);
+    QSharedPointer<QString> error(new QString);
+    QSharedPointer<bool> success(new bool(true));
+    for(int x = 0; x < futures.count(); ++x) {
+        values->append(QVariant());
+        futures.at(x).onFinished([=](const FtpFuture &result) {
+            (*values)[x] = result.value();
+            if(!result.isSuccess() && *success) {
+                *success = false;
+                *error = result.errorString();
+            }
+            if(--(*remaining) == 0) {
+                if(*success)
+                    promise.resolve(*values);
+                else
+                    promise.reject(*error);
+            }
+        });
+    }
+    return promise.future();
+}
+
+// Finishes with the result of whichever future finishes first.
+FtpFuture FtpFuture::whenAny(QList<FtpFuture> futures)
+{
+    if(futures.isEmpty())
+        return failed("Nothing to wait for");
+    FtpPromise promise;
+    foreach (FtpFuture future, futures) {
+        future.onFinished([promise](const FtpFuture &result) {
+            if(!promise.future().isFinished())
+                promise.finishFrom(result);
+        });
+    }
+    return promise.future();
+}
+
+FtpPromise::FtpPromise()
+{
+}
+
+FtpFuture FtpPromise::future() const
+{
+    return m_future;
+}
+
+void FtpPromise::resolve(QVariant value, int replyCode, QString replyText) const
+{
+    finish(true, QString(), replyCode, replyText, value);
+}
+
+void FtpPromise::reject(QString errorString, int replyCode, QString replyText) const
+{
+    finish(false, errorString, replyCode, replyText, QVariant());
+}
+
+void FtpPromise::finishFrom(const FtpFuture &other) const
+{
+    finish(other.isSuccess(), other.errorString(), other.replyCode(), other.replyText(), other.value());
+}
+
+void FtpPromise::finish(bool success, QString errorString, int replyCode, QString replyText, QVariant value) const
+{
+    FtpFuture::state *d = m_future.d.data();
+    if(d->finished)
+        return;
+    d->finished = true;
+    d->success = success;
+    d->errorString = errorString;
+    d->replyCode = replyCode;
+    d->replyText = replyText;
+    d->value = value;
+    // taken out first: callbacks may attach further callbacks to this future
+    QList<FtpFuture::callback> callbacks = d->callbacks;
+    d->callbacks.clear();
+    foreach (FtpFuture::callback cb, callbacks) {
+        cb(m_future);
+    }
+}
+
+AsyncFtp::AsyncFtp(QFtp *ftp, QObject *parent) : QObject(parent), m_ftp(ftp), m_currentId(0), m_replyCode(0)
+{
+    connect(m_ftp, SIGNAL(commandFinished(int,bool)), this, SLOT(onCommandFinished(int,bool)));
+    connect(m_ftp, SIGNAL(rawCommandReply(int,QString)), this, SLOT(onRawCommandReply(int,QString)));
+    connect(m_ftp, SIGNAL(listInfos(QVector<QUrlInfo>)), this, SLOT(onListInfos(QVector<QUrlInfo>)));
+    connect(m_ftp, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+FtpFuture AsyncFtp::connectToHost(QString host, quint16 port)
+{
+    return enqueue("Connect to host", [=]() { return m_ftp->connectToHost(host, port); });
+}
+
+FtpFuture AsyncFtp::login(QString user, QString password)
+{
+    return enqueue("Logging in to host", [=]() { return m_ftp->login(user, password); });
+}
+
+// The value of the future is the QUrlInfoList of the accepted entries.
+FtpFuture AsyncFtp::list(QString dir, QFtp::ListPredicate filter, QFtp::ListPredicate stop)
+{
+    return enqueue(QString("Listing directory %0 contents").arg(dir), [=]() { return m_ftp->list(dir, filter, stop); });
+}
+
+// The value of the future is the downloaded data.
+FtpFuture AsyncFtp::get(QString file)
+{
+    return enqueue(QString("Fetching file %0").arg(file), [=]() { return m_ftp->get(file); });
+}
+
+// The data is handed to onData as it arrives instead of being kept for the
+// value of the future, which stays empty.
+FtpFuture AsyncFtp::get(QString file, dataHandler onData)
+{
+    return enqueue(QString("Fetching file %0").arg(file), [=]() { return m_ftp->get(file); }, onData);
+}
+
+FtpFuture AsyncFtp::put(QByteArray data, QString file)
+{
+    return enqueue(QString("Pushing file:%0").arg(file), [=]() { return m_ftp->put(data, file); });
+}
+
+FtpFuture AsyncFtp::put(QIODevice *dev, QString file, qint64 offset)
+{
+    return enqueue(QString("Pushing file %0").arg(file), [=]() { return m_ftp->put(dev, file, offset); });
+}
+
+FtpFuture AsyncFtp::remove(QString file)
+{
+    return enqueue(QString("Removing file %0 from server").arg(file), [=]() { return m_ftp->remove(file); });
+}
+
+FtpFuture AsyncFtp::mkdir(QString dir)
+{
+    return enqueue(QString("Creating directory %0").arg(dir), [=]() { return m_ftp->mkdir(dir); });
+}
+
+FtpFuture AsyncFtp::rename(QString oldname, QString newname)
+{
+    return enqueue(QString("Renaming %0 to %1").arg(oldname).arg(newname), [=]() { return m_ftp->rename(oldname, newname); });
+}
+
+// The reply of the server is in replyCode() and replyText() of the future.
+FtpFuture AsyncFtp::rawCommand(QString command)
+{
+    return enqueue(QString("Sending %0").arg(command), [=]() { return m_ftp->rawCommand(command); });
+}
+
+bool AsyncFtp::isIdle() const
+{
+    return m_currentId == 0 && m_queue.isEmpty();
+}
+
+FtpFuture AsyncFtp::enqueue(QString description, std::function<int ()> submit, dataHandler onData)
+{
+    command cmd;
+    cmd.description = description;
+    cmd.submit = submit;
+    cmd.onData = onData;
+    m_queue.append(cmd);
+    submitNext();
+    return cmd.promise.future();
+}
+
+void AsyncFtp::submitNext()
+{
+    if(m_currentId != 0 || m_queue.isEmpty())
+        return;
+    m_current = m_queue.takeFirst();
+    m_replyCode = 0;
+    m_replyText.clear();
+    m_listing.clear();
+    m_currentId = m_current.submit();
+    qCDebug(lcFtp) << "Command" << m_currentId << m_current.description;
+}
+
+void AsyncFtp::onCommandFinished(int id, bool error)
+{
+    if(id != m_currentId)
+        return;
+    command finished = m_current;
+    m_currentId = 0;
+    m_current = command();
+    qCDebug(lcFtp) << "Command" << id << "finished, error:" << error << "reply" << m_replyCode << m_replyText;
+    emit operationFinished(finished.description, error, m_ftp->errorString());
+    if(error) {
+        finished.promise.reject(m_ftp->errorString(), m_replyCode, m_replyText);
+    }
+    else {
+        QVariant value;
+        if(m_ftp->currentCommand() == QFtp::Get && finished.onData)
+            finished.onData(m_ftp->readAll());
+        else if(m_ftp->currentCommand() == QFtp::Get)
+            value = m_ftp->readAll();
+        else if(m_ftp->currentCommand() == QFtp::List)
+            value = QVariant::fromValue(m_listing);
+        finished.promise.resolve(value, m_replyCode, m_replyText);
+    }
+    // continuations may already have queued and submitted more work
+    submitNext();
+}
+
+void AsyncFtp::onRawCommandReply(int replyCode, const QString &detail)
+{
+    m_replyCode = replyCode;
+    m_replyText = detail;
+}
+
+void AsyncFtp::onListInfos(const QVector<QUrlInfo> &infos)
+{
+    m_listing.append(infos);
+}
+
+void AsyncFtp::onReadyRead()
+{
+    if(m_currentId != 0 && m_current.onData)
+        m_current.onData(m_ftp->readAll());
+}
@@ -0,0 +1,157 @@
+/**
+ ******************************************************************************
+ * @file       asyncftp.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup AsyncFtp
+ * @{
+ * @brief Future based interface to QFtp
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ASYNCFTP_H
+#define ASYNCFTP_H
+
+#include "qftp.h"
+#include "qurlinfolist.h"
+#include <QObject>
+#include <QSharedPointer>
+#include <QVariant>
+#include <QList>
+#include <functional>
+
+Q_DECLARE_METATYPE(QUrlInfoList)
+
+/**
+ * Result of an asynchronous FTP operation. Copies share the same result.
+ *
+ * Work that depends on the result is attached with onFinished(), then() or
+ * andThen() instead of waiting for it; then() and andThen() return a future
+ * for the work they chain, so whole sequences can be built up front.
+ * Callbacks run on the thread and from the signal that finished the
+ * operation, or right away if it already finished.
+ */
+class FtpFuture
+{
+public:
+    typedef std::function<void (const FtpFuture &)> callback;
+    typedef std::function<FtpFuture (const FtpFuture &)> continuation;
+
+    FtpFuture();
+    bool isFinished() const;
+    bool isSuccess() const;
+    QString errorString() const;
+    int replyCode() const;
+    QString replyText() const;
+    QVariant value() const;
+
+    void onFinished(callback cb) const;
+    FtpFuture then(continuation next) const;
+    FtpFuture andThen(std::function<FtpFuture ()> next) const;
+
+    static FtpFuture succeeded(QVariant value = QVariant());
+    static FtpFuture failed(QString errorString);
+    static FtpFuture whenAll(QList<FtpFuture> futures);
+    static FtpFuture whenAny(QList<FtpFuture> futures);
+private:
+    friend class FtpPromise;
+    struct state
+    {
+        bool finished;
+        bool success;
+        QString errorString;
+        int replyCode;
+        QString replyText;
+        QVariant value;
+        QList<callback> callbacks;
+    };
+    QSharedPointer<state> d;
+};
+
+/**
+ * Producer side of an FtpFuture; finishing it runs the attached callbacks.
+ */
+class FtpPromise
+{
+public:
+    FtpPromise();
+    FtpFuture future() const;
+    void resolve(QVariant value = QVariant(), int replyCode = 0, QString replyText = QString()) const;
+    void reject(QString errorString, int replyCode = 0, QString replyText = QString()) const;
+    void finishFrom(const FtpFuture &other) const;
+private:
+    void finish(bool success, QString errorString, int replyCode, QString replyText, QVariant value) const;
+    FtpFuture m_future;
+};
+
+/**
+ * Queues commands on a QFtp connection and returns an FtpFuture for each.
+ *
+ * QFtp drops every queued command when one fails; here commands are handed
+ * to QFtp one at a time, so a failing command only fails its own future and
+ * unrelated work queued behind it still runs. Chains that depend on a
+ * result use andThen() to stop at the first failure.
+ *
+ * Remote paths are relative to the login directory; the facade never
+ * changes the working directory, so chains can be interleaved freely.
+ */
+class AsyncFtp : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void (const QByteArray &data)> dataHandler;
+    AsyncFtp(QFtp *ftp, QObject *parent = 0);
+    FtpFuture connectToHost(QString host, quint16 port = 21);
+    FtpFuture login(QString user, QString password);
+    FtpFuture list(QString dir, QFtp::ListPredicate filter = QFtp::ListPredicate(), QFtp::ListPredicate stop = QFtp::ListPredicate());
+    FtpFuture get(QString file);
+    FtpFuture get(QString file, dataHandler onData);
+    FtpFuture put(QByteArray data, QString file);
+    FtpFuture put(QIODevice *dev, QString file, qint64 offset = 0);
+    FtpFuture remove(QString file);
+    FtpFuture mkdir(QString dir);
+    FtpFuture rename(QString oldname, QString newname);
+    FtpFuture rawCommand(QString command);
+    bool isIdle() const;
+signals:
+    void operationFinished(QString description, bool error, QString errorString);
+private slots:
+    void onCommandFinished(int id, bool error);
+    void onRawCommandReply(int replyCode, const QString &detail);
+    void onListInfos(const QVector<QUrlInfo> &infos);
+    void onReadyRead();
+private:
+    struct command
+    {
+        QString description;
+        std::function<int ()> submit;
+        FtpPromise promise;
+        dataHandler onData;
+    };
+    FtpFuture enqueue(QString description, std::function<int ()> submit, dataHandler onData = dataHandler());
+    void submitNext();
+    QFtp *m_ftp;
+    QList<command> m_queue;
+    command m_current;
+    int m_currentId;
+    int m_replyCode;
+    QString m_replyText;
+    QUrlInfoList m_listing;
+};
+
+#endif // ASYNCFTP_H
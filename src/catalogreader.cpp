@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file       catalogreader.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup CatalogReader
+ * @{
+ * @brief Parses the information file as its bytes arrive
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "catalogreader.h"
+#include "catalogtags.h"
+#include "logging.h"
+
+CatalogReader::CatalogReader() : m_hash(QCryptographicHash::Md5), m_depth(0), m_board(false), m_done(false), m_size(0)
+{
+}
+
+void CatalogReader::addData(const QByteArray &data)
+{
+    if(data.isEmpty())
+        return;
+    m_hash.addData(data);
+    m_size += data.size();
+    if(hasFailed())
+        return;
+    m_reader.addData(data);
+    readAvailable();
+}
+
+// Reads every token of the data received so far
+void CatalogReader::readAvailable()
+{
+    while(!m_reader.atEnd() && !hasFailed()) {
+        switch (m_reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            ++m_depth;
+            if(!readStartElement())
+                return;
+            break;
+        case QXmlStreamReader::EndElement:
+            if(--m_depth == 0)
+                m_done = true;
+            break;
+        default:
+            break;
+        }
+    }
+    if(m_reader.hasError() && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError)
+        fail(m_reader.errorString());
+}
+
+// root, release, OS, then either a software type with its d<date> items or
+// a t<hw> board holding the embedded types and their items; anything below
+// an item is ignored
+bool CatalogReader::readStartElement()
+{
+    QStringRef name = m_reader.name();
+    bool known = true;
+    switch (m_depth) {
+    case 1:
+        break;
+    case 2:
+        known = CatalogTags::releaseOf(name, m_key.release);
+        break;
+    case 3:
+        known = CatalogTags::osOf(name, m_key.osType);
+        break;
+    case 4:
+        m_key.hwType = 0;
+        m_board = CatalogTags::hwOf(name, m_key.hwType);
+        known = m_board || CatalogTags::softOf(name, m_key.type);
+        break;
+    case 5:
+        if(m_board)
+            known = CatalogTags::softOf(name, m_key.type);
+        else
+            readItem(name);
+        break;
+    case 6:
+        if(m_board)
+            readItem(name);
+        break;
+    default:
+        break;
+    }
+    if(!known) {
+        fail(QString("Unexpected element %0").arg(name.toString()));
+        return false;
+    }
+    return true;
+}
+
+// The d<date> element the reader is on; the links are kept as text, a QUrl
+// is only built when an item is asked for
+void CatalogReader::readItem(const QStringRef &name)
+{
+    SoftCatalog::entry data;
+    QXmlStreamAttributes attributes = m_reader.attributes();
+    data.name = attributes.value("name").toString();
+    //the writer has always written uvohash; uavohash is what the old DOM
+    //parser looked for, so a file edited to match it still loads
+    if(attributes.hasAttribute("uvohash"))
+        data.uavHash = attributes.value("uvohash").toString();
+    else
+        data.uavHash = attributes.value("uavohash").toString();
+    data.md5 = attributes.value("md5").toString();
+    data.packageLink = attributes.value("packageLink").toString();
+    data.releaseLink = attributes.value("releaseLink").toString();
+    data.scriptLink = attributes.value("scriptLink").toString();
+    data.date = CatalogTags::dateOf(name);
+    qCDebug(lcParser) << "Item" << data.name << "release" << m_key.release << "os" << m_key.osType << "type" << m_key.type << "hw" << m_key.hwType;
+    m_catalog.insert(m_key, data);
+}
+
+void CatalogReader::fail(QString error)
+{
+    if(m_error.isEmpty()) {
+        qCDebug(lcParser) << "Parsing failed on line" << m_reader.lineNumber() << ":" << error;
+        m_error = error;
+    }
+}
+
+// To be called once all the data was fed; false if the file was invalid or
+// ended early
+bool CatalogReader::finish()
+{
+    if(!hasFailed() && !m_done)
+        fail(m_size == 0 ? "Empty file" : "Premature end of document");
+    if(hasFailed())
+        m_catalog.clear();
+    return !hasFailed();
+}
+
+bool CatalogReader::hasFailed() const
+{
+    return !m_error.isEmpty();
+}
+
+QString CatalogReader::errorString() const
+{
+    return m_error;
+}
+
+qint64 CatalogReader::lineNumber() const
+{
+    return m_reader.lineNumber();
+}
+
+qint64 CatalogReader::columnNumber() const
+{
+    return m_reader.columnNumber();
+}
+
+// Bytes fed so far
+qint64 CatalogReader::size() const
+{
+    return m_size;
+}
+
+QString CatalogReader::sourceMD5() const
+{
+    return QString(m_hash.result().toHex());
+}
+
+const SoftCatalog &CatalogReader::catalog() const
+{
+    return m_catalog;
+}
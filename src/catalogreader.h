@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file       catalogreader.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup CatalogReader
+ * @{
+ * @brief Parses the information file as its bytes arrive
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef CATALOGREADER_H
+#define CATALOGREADER_H
+
+#include <QXmlStreamReader>
+#include <QCryptographicHash>
+#include "softcatalog.h"
+
+/**
+ * Incremental parser of the information file. Bytes are fed with addData()
+ * as they come from the network, and every record is added to the catalog
+ * as soon as its element is read. When the document is cut in the middle of
+ * a token the reader waits for the next chunk, so fetching and parsing
+ * overlap and the whole file is never held in memory.
+ *
+ * After the last chunk, finish() tells whether a complete and valid file was
+ * read. The md5 of everything fed is kept for the catalog snapshot.
+ */
+class CatalogReader
+{
+public:
+    CatalogReader();
+    void addData(const QByteArray &data);
+    bool finish();
+    bool hasFailed() const;
+    QString errorString() const;
+    qint64 lineNumber() const;
+    qint64 columnNumber() const;
+    qint64 size() const;
+    QString sourceMD5() const;
+    const SoftCatalog &catalog() const;
+private:
+    void readAvailable();
+    bool readStartElement();
+    void readItem(const QStringRef &name);
+    void fail(QString error);
+    QXmlStreamReader m_reader;
+    QCryptographicHash m_hash;
+    SoftCatalog m_catalog;
+    SoftCatalog::groupKey m_key;
+    int m_depth;
+    bool m_board;
+    bool m_done;
+    qint64 m_size;
+    QString m_error;
+};
+
+#endif // CATALOGREADER_H
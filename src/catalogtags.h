@@ -0,0 +1,191 @@
+/**
+ ******************************************************************************
+ * @file       catalogtags.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup CatalogTags
+ * @{
+ * @brief Element names of the information file
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef CATALOGTAGS_H
+#define CATALOGTAGS_H
+
+#include <QStringRef>
+#include <QLatin1String>
+#include <QDate>
+#include "xmlparser.h"
+
+/**
+ * Element names of the information file, shared by the reader and the
+ * writer. The tables are indexed by the enums; the lookups switch on the
+ * length of the name and a distinguishing character, then confirm the one
+ * candidate with a single comparison. Nothing here allocates, so the reader
+ * can decode every element straight from the QStringRef it gets.
+ */
+namespace CatalogTags
+{
+constexpr const char *releaseTags[] = {"current_release", "test_release", "old_release"};
+constexpr const char *osTags[] = {"win32", "win64", "osx32", "osx64", "linux32", "linux64", "embeded"};
+constexpr const char *softTags[] = {"gcs", "slim_gcs", "updater", "firmware", "bootloader", "settings"};
+
+static_assert(sizeof(releaseTags) / sizeof(releaseTags[0]) == xmlParser::RELEASE_OLD + 1, "one tag per release type");
+static_assert(sizeof(osTags) / sizeof(osTags[0]) == xmlParser::OS_EMBEDED + 1, "one tag per OS type");
+static_assert(sizeof(softTags) / sizeof(softTags[0]) == xmlParser::SOFT_SETTINGS + 1, "one tag per software type");
+
+constexpr char hwPrefix = 't';
+constexpr char datePrefix = 'd';
+
+inline QLatin1String releaseTag(xmlParser::releaseTypeEnum release)
+{
+    return QLatin1String(releaseTags[release]);
+}
+
+inline QLatin1String osTag(xmlParser::osTypeEnum os)
+{
+    return QLatin1String(osTags[os]);
+}
+
+inline QLatin1String softTag(xmlParser::softTypeEnum soft)
+{
+    return QLatin1String(softTags[soft]);
+}
+
+// The table entry at index, if it is name; -1 otherwise
+inline int confirm(const QStringRef &name, const char *const table[], int index)
+{
+    return (index >= 0 && name == QLatin1String(table[index])) ? index : -1;
+}
+
+inline bool releaseOf(const QStringRef &name, xmlParser::releaseTypeEnum &release)
+{
+    int index = -1;
+    switch (name.size()) {
+    case 15:
+        index = xmlParser::RELEASE_CURRENT;
+        break;
+    case 12:
+        index = xmlParser::RELEASE_TEST;
+        break;
+    case 11:
+        index = xmlParser::RELEASE_OLD;
+        break;
+    }
+    index = confirm(name, releaseTags, index);
+    if(index < 0)
+        return false;
+    release = xmlParser::releaseTypeEnum(index);
+    return true;
+}
+
+inline bool osOf(const QStringRef &name, xmlParser::osTypeEnum &os)
+{
+    int index = -1;
+    switch (name.size()) {
+    case 5:
+        //win32 win64 osx32 osx64
+        if(name.at(0) == QLatin1Char('w'))
+            index = name.at(3) == QLatin1Char('3') ? xmlParser::OS_WIN32 : xmlParser::OS_WIN64;
+        else
+            index = name.at(3) == QLatin1Char('3') ? xmlParser::OS_OSX32 : xmlParser::OS_OSX64;
+        break;
+    case 7:
+        //linux32 linux64 embeded
+        if(name.at(0) == QLatin1Char('e'))
+            index = xmlParser::OS_EMBEDED;
+        else
+            index = name.at(5) == QLatin1Char('3') ? xmlParser::OS_LINUX32 : xmlParser::OS_LINUX64;
+        break;
+    }
+    index = confirm(name, osTags, index);
+    if(index < 0)
+        return false;
+    os = xmlParser::osTypeEnum(index);
+    return true;
+}
+
+inline bool softOf(const QStringRef &name, xmlParser::softTypeEnum &soft)
+{
+    int index = -1;
+    switch (name.size()) {
+    case 3:
+        index = xmlParser::SOFT_GCS;
+        break;
+    case 7:
+        index = xmlParser::SOFT_UPDATER;
+        break;
+    case 8:
+        //slim_gcs firmware settings
+        if(name.at(0) == QLatin1Char('f'))
+            index = xmlParser::SOFT_FIRMWARE;
+        else
+            index = name.at(1) == QLatin1Char('e') ? xmlParser::SOFT_SETTINGS : xmlParser::SOFT_SLIM_GCS;
+        break;
+    case 10:
+        index = xmlParser::SOFT_BOOTLOADER;
+        break;
+    }
+    index = confirm(name, softTags, index);
+    if(index < 0)
+        return false;
+    soft = xmlParser::softTypeEnum(index);
+    return true;
+}
+
+// The count decimal digits of name starting at from, false if something
+// else is found there or the value is over max
+inline bool digitsOf(const QStringRef &name, int from, int count, int max, int &value)
+{
+    if(count <= 0 || name.size() < from + count)
+        return false;
+    value = 0;
+    for(int x = from; x < from + count; ++x) {
+        int digit = name.at(x).unicode() - '0';
+        if(digit < 0 || digit > 9)
+            return false;
+        value = value * 10 + digit;
+        if(value > max)
+            return false;
+    }
+    return true;
+}
+
+// t<hw>, the hardware type of a board in decimal
+inline bool hwOf(const QStringRef &name, quint16 &hwType)
+{
+    int value;
+    if(name.isEmpty() || name.at(0) != QLatin1Char(hwPrefix) || !digitsOf(name, 1, name.size() - 1, 0xFFFF, value))
+        return false;
+    hwType = quint16(value);
+    return true;
+}
+
+// d<ddMMyyyy>, the date of an item; an invalid date if name is not one
+inline QDate dateOf(const QStringRef &name)
+{
+    int day, month, year;
+    if(name.size() != 9 || name.at(0) != QLatin1Char(datePrefix))
+        return QDate();
+    if(!digitsOf(name, 1, 2, 31, day) || !digitsOf(name, 3, 2, 12, month) || !digitsOf(name, 5, 4, 9999, year))
+        return QDate();
+    return QDate(year, month, day);
+}
+}
+
+#endif // CATALOGTAGS_H
@@ -0,0 +1,262 @@
+/**
+ ******************************************************************************
+ * @file       ingestbatch.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestBatch
+ * @{
+ * @brief Downloads and ingests a list of packages in one run
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "ingestbatch.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QRegExp>
+
+#define MAX_PARALLEL_DOWNLOADS 2
+
+template <typename T>
+static bool valueOf(const QHash<T, QString> &hash, QString text, T &value)
+{
+    for(typename QHash<T, QString>::const_iterator i = hash.constBegin(); i != hash.constEnd(); ++i) {
+        if(i.value().compare(text, Qt::CaseInsensitive) == 0) {
+            value = i.key();
+            return true;
+        }
+    }
+    return false;
+}
+
+IngestBatch::IngestBatch(IngestEngine *engine, IngestBatch::downloader download, QObject *parent) : QObject(parent),
+    m_engine(engine), m_download(download), m_downloading(0), m_remaining(0)
+{
+    connect(m_engine, SIGNAL(jobFinished(int,bool)), this, SLOT(onJobFinished(int,bool)));
+}
+
+// One package per line: link;OS;type;hardware[;name], the OS, type and
+// hardware spelled as in the item form. Hardware all on a firmware or
+// bootloader line takes every board of the bundle. Empty lines and lines
+// starting with # are skipped. Only the fields of the list are set on the returned requests.
+QList<IngestJob::request> IngestBatch::parse(QString text, QStringList &errors)
+{
+    QList<IngestJob::request> requests;
+    int lineNumber = 0;
+    foreach (QString line, text.split('\n')) {
+        ++lineNumber;
+        line = line.trimmed();
+        if(line.isEmpty() || line.startsWith("#"))
+            continue;
+        QStringList fields = line.split(';');
+        if(fields.length() < 4 || fields.length() > 5) {
+            errors.append(QString("Line %0: expected link;OS;type;hardware[;name]").arg(lineNumber));
+            continue;
+        }
+        IngestJob::request request;
+        request.packageLink = fields.at(0).trimmed();
+        if(!valueOf(xmlParser::osTypeToStringHash, fields.at(1).trimmed(), request.osType)) {
+            errors.append(QString("Line %0: unknown OS %1").arg(lineNumber).arg(fields.at(1).trimmed()));
+            continue;
+        }
+        if(!valueOf(xmlParser::softTypeToStringHash, fields.at(2).trimmed(), request.type)) {
+            errors.append(QString("Line %0: unknown type %1").arg(lineNumber).arg(fields.at(2).trimmed()));
+            continue;
+        }
+        request.bundle = (fields.at(3).trimmed().compare("all", Qt::CaseInsensitive) == 0) &&
+                ((request.type == xmlParser::SOFT_FIRMWARE) || (request.type == xmlParser::SOFT_BOOTLOADER));
+        if(request.bundle)
+            request.hwType = 0;
+        else if(!valueOf(xmlParser::hwTypeToStringHash, fields.at(3).trimmed(), request.hwType)) {
+            errors.append(QString("Line %0: unknown hardware %1").arg(lineNumber).arg(fields.at(3).trimmed()));
+            continue;
+        }
+        bool embedded = (request.type == xmlParser::SOFT_FIRMWARE) || (request.type == xmlParser::SOFT_BOOTLOADER) || (request.type == xmlParser::SOFT_SETTINGS);
+        if(embedded != (request.osType == xmlParser::OS_EMBEDED) || (request.type != xmlParser::SOFT_SETTINGS && !request.bundle && embedded != (request.hwType != 0))) {
+            errors.append(QString("Line %0: OS, type and hardware don't match").arg(lineNumber));
+            continue;
+        }
+        if(fields.length() == 5)
+            request.name = fields.at(4).trimmed();
+        if(request.name.isEmpty())
+            request.name = QFileInfo(request.packageLink).fileName();
+        requests.append(request);
+    }
+    return requests;
+}
+
+// Tells what a build artifact is from its file name, as the build server
+// names them. Firmware archives are taken as bundles of every board.
+// Sets the kind of item and its name on the request.
+// OS and word size come from whole tokens of the name, so neither "darwin"
+// nor a version number like 1.64 is mistaken for Windows or 64 bit.
+bool IngestBatch::classify(QString fileName, IngestJob::request &request)
+{
+    QString name = fileName.toLower();
+    QSet<QString> tokens = name.split(QRegExp("[-_.]"), QString::SkipEmptyParts).toSet();
+    bool is64 = tokens.contains("64") || tokens.contains("x64") || tokens.contains("amd64") ||
+            tokens.contains("win64") || tokens.contains("osx64") || tokens.contains("linux64");
+    bool is32 = !is64 && (tokens.contains("32") || tokens.contains("x86") || tokens.contains("i386") || tokens.contains("i686") ||
+                          tokens.contains("win32") || tokens.contains("osx32") || tokens.contains("linux32"));
+    request.hwType = 0;
+    request.bundle = false;
+    request.name = fileName;
+    if(name.contains("firmware") || name.contains("flight") || name.startsWith("fw_")) {
+        request.osType = xmlParser::OS_EMBEDED;
+        request.type = xmlParser::SOFT_FIRMWARE;
+        request.bundle = true;
+        return true;
+    }
+    if(tokens.contains("osx") || tokens.contains("osx32") || tokens.contains("osx64") || tokens.contains("mac") ||
+            tokens.contains("macos") || tokens.contains("darwin") || tokens.contains("dmg"))
+        request.osType = is32 ? xmlParser::OS_OSX32 : xmlParser::OS_OSX64;
+    else if(tokens.contains("win") || tokens.contains("win32") || tokens.contains("win64") || tokens.contains("windows") ||
+            name.endsWith(".exe"))
+        request.osType = is64 ? xmlParser::OS_WIN64 : xmlParser::OS_WIN32;
+    else if(tokens.contains("linux") || tokens.contains("linux32") || tokens.contains("linux64"))
+        request.osType = is64 ? xmlParser::OS_LINUX64 : xmlParser::OS_LINUX32;
+    else
+        return false;
+    if(name.contains("updater"))
+        request.type = xmlParser::SOFT_UPDATER;
+    else if(name.contains("slim") || name.contains("agent"))
+        request.type = xmlParser::SOFT_SLIM_GCS;
+    else
+        request.type = xmlParser::SOFT_GCS;
+    return true;
+}
+
+// Catalog MD5s are of the staged release files. Only these types are
+// staged as downloaded; the others are extracted or repackaged first, so
+// their download can't be told apart by its MD5.
+static bool stagedUnchanged(xmlParser::softTypeEnum type)
+{
+    return type == xmlParser::SOFT_UPDATER || type == xmlParser::SOFT_SETTINGS;
+}
+
+// Downloaded updaters and settings files with one of these MD5s are already
+// released and are dropped without being processed
+void IngestBatch::setKnownDigests(QSet<QString> digests)
+{
+    m_knownDigests = digests;
+}
+
+// The requests must be complete, as for IngestEngine::submit()
+void IngestBatch::start(QList<IngestJob::request> requests)
+{
+    m_remaining = requests.count();
+    foreach (IngestJob::request request, requests) {
+        entry e;
+        e.request = request;
+        e.jobId = 0;
+        e.finished = false;
+        e.success = false;
+        m_entries.append(e);
+    }
+    for(int x = 0; x < m_entries.count(); ++x) {
+        QString link = m_entries.at(x).request.packageLink;
+        if(QFile::exists(m_entries.at(x).request.packagePath)) {
+            emit logMessage(QString("File %0 already present on temporary folder, skipping download").arg(QFileInfo(m_entries.at(x).request.packagePath).fileName()));
+            submit(x, QByteArray());
+            continue;
+        }
+        if(!m_entriesByLink.contains(link))
+            m_pendingLinks.append(link);
+        m_entriesByLink[link].append(x);
+    }
+    if(m_remaining == 0)
+        emit finished();
+    startDownloads();
+}
+
+bool IngestBatch::contains(int jobId) const
+{
+    return m_entryByJob.contains(jobId);
+}
+
+int IngestBatch::count() const
+{
+    return m_entries.count();
+}
+
+QList<IngestBatch::entry> IngestBatch::entries() const
+{
+    return m_entries;
+}
+
+void IngestBatch::startDownloads()
+{
+    while(m_downloading < MAX_PARALLEL_DOWNLOADS && !m_pendingLinks.isEmpty()) {
+        QString link = m_pendingLinks.takeFirst();
+        ++m_downloading;
+        emit logMessage(QString("Starting %0 download").arg(link));
+        m_download(link).onFinished([this, link](const FtpFuture &result) {
+            --m_downloading;
+            bool known = result.isSuccess() && !m_knownDigests.isEmpty() &&
+                    m_knownDigests.contains(QString(QCryptographicHash::hash(result.value().toByteArray(), QCryptographicHash::Md5).toHex()));
+            foreach (int index, m_entriesByLink.value(link)) {
+                if(known && stagedUnchanged(m_entries.at(index).request.type)) {
+                    emit logMessage(QString("%0 is already in the catalog, skipping").arg(link));
+                    finishEntry(index, true);
+                }
+                else if(result.isSuccess()) {
+                    submit(index, result.value().toByteArray());
+                }
+                else {
+                    emit logMessage(QString("%0 download failed with error:%1").arg(link).arg(result.errorString()));
+                    finishEntry(index, false);
+                }
+            }
+            startDownloads();
+        });
+    }
+}
+
+void IngestBatch::submit(int index, QByteArray data)
+{
+    IngestJob::request request = m_entries.at(index).request;
+    request.packageData = data;
+    int id = m_engine->submit(request);
+    m_entries[index].jobId = id;
+    m_entryByJob.insert(id, index);
+}
+
+void IngestBatch::onJobFinished(int id, bool success)
+{
+    if(!m_entryByJob.contains(id))
+        return;
+    int index = m_entryByJob.take(id);
+    IngestJob *job = m_engine->takeJob(id);
+    if(job) {
+        m_entries[index].outputs = job->outputs();
+        m_entries[index].stagingDir = job->stagingDir();
+        job->deleteLater();
+    }
+    if(!success)
+        emit logMessage(QString("Processing of %0 FAILED").arg(m_entries.at(index).request.name));
+    finishEntry(index, success && job != NULL);
+}
+
+void IngestBatch::finishEntry(int index, bool success)
+{
+    m_entries[index].finished = true;
+    m_entries[index].success = success;
+    if(--m_remaining == 0)
+        emit finished();
+}
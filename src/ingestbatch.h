@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file       ingestbatch.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestBatch
+ * @{
+ * @brief Downloads and ingests a list of packages in one run
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef INGESTBATCH_H
+#define INGESTBATCH_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <functional>
+#include "ingestengine.h"
+#include "asyncftp.h"
+
+/**
+ * Takes a list of packages through download, extraction, verification,
+ * packaging and staging as a pipeline: a few downloads run while the
+ * packages already downloaded are processed by the engine, so network,
+ * CPU and disk work of different packages overlap. Packages that share a
+ * link are downloaded once.
+ *
+ * Results are kept until every package is finished and then handed over
+ * as a whole through finished() and entries(), in the order of the list.
+ */
+class IngestBatch : public QObject
+{
+    Q_OBJECT
+public:
+    struct entry
+    {
+        IngestJob::request request;
+        int jobId;
+        bool finished;
+        bool success;
+        QList<IngestJob::output> outputs;
+        QString stagingDir;
+    };
+    typedef std::function<FtpFuture (QString link)> downloader;
+
+    IngestBatch(IngestEngine *engine, downloader download, QObject *parent = 0);
+    static QList<IngestJob::request> parse(QString text, QStringList &errors);
+    static bool classify(QString fileName, IngestJob::request &request);
+    void setKnownDigests(QSet<QString> digests);
+    void start(QList<IngestJob::request> requests);
+    bool contains(int jobId) const;
+    int count() const;
+    QList<entry> entries() const;
+signals:
+    void logMessage(QString text);
+    void finished();
+private slots:
+    void onJobFinished(int id, bool success);
+private:
+    void startDownloads();
+    void submit(int index, QByteArray data);
+    void finishEntry(int index, bool success);
+    IngestEngine *m_engine;
+    downloader m_download;
+    QList<entry> m_entries;
+    QStringList m_pendingLinks;
+    QHash<QString, QList<int> > m_entriesByLink;
+    QHash<int, int> m_entryByJob;
+    QSet<QString> m_knownDigests;
+    int m_downloading;
+    int m_remaining;
+};
+
+#endif // INGESTBATCH_H
@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file       ingestengine.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestEngine
+ * @{
+ * @brief Runs ingestion jobs on a pool of worker threads
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "ingestengine.h"
+#include <QDir>
+
+#define DISK_THREADS 2
+
+IngestEngine::IngestEngine(QString stagingRoot, QObject *parent) : QObject(parent), m_stagingRoot(stagingRoot), m_nextId(0)
+{
+    if(!m_stagingRoot.endsWith(QDir::separator()))
+        m_stagingRoot.append(QDir::separator());
+    m_diskPool.setMaxThreadCount(DISK_THREADS);
+}
+
+IngestEngine::~IngestEngine()
+{
+    // running jobs stop after their current phase, the next one would be
+    // scheduled from the event loop
+    m_diskPool.waitForDone();
+    m_cpuPool.waitForDone();
+}
+
+int IngestEngine::submit(IngestJob::request request)
+{
+    int id = ++m_nextId;
+    request.stagingDir = m_stagingRoot + QString("job%0").arg(id) + QDir::separator();
+    QDir(request.stagingDir).removeRecursively();
+    IngestJob *job = new IngestJob(id, request, this);
+    connect(job, SIGNAL(stageChanged(int,int)), this, SIGNAL(stageChanged(int,int)));
+    connect(job, SIGNAL(progress(int,qint64,qint64)), this, SIGNAL(progress(int,qint64,qint64)));
+    connect(job, SIGNAL(logMessage(int,QString)), this, SIGNAL(logMessage(int,QString)));
+    connect(job, SIGNAL(finished(int,bool)), this, SIGNAL(jobFinished(int,bool)));
+    connect(job, SIGNAL(phaseFinished(int)), this, SLOT(onPhaseFinished(int)));
+    m_jobs.insert(id, job);
+    schedule(job);
+    return id;
+}
+
+void IngestEngine::onPhaseFinished(int id)
+{
+    IngestJob *job = m_jobs.value(id, NULL);
+    if(job)
+        schedule(job);
+}
+
+void IngestEngine::schedule(IngestJob *job)
+{
+    if(IngestJob::isDiskBound(job->phase()))
+        m_diskPool.start(job);
+    else
+        m_cpuPool.start(job);
+}
+
+IngestJob *IngestEngine::job(int id) const
+{
+    return m_jobs.value(id, NULL);
+}
+
+IngestJob *IngestEngine::takeJob(int id)
+{
+    IngestJob *job = m_jobs.take(id);
+    if(job)
+        job->setParent(NULL);
+    return job;
+}
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @file       ingestengine.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestEngine
+ * @{
+ * @brief Runs ingestion jobs on a pool of worker threads
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef INGESTENGINE_H
+#define INGESTENGINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QThreadPool>
+#include "ingestjob.h"
+
+/**
+ * Owns the ingestion jobs and the worker threads they run on. Every job
+ * gets its own staging directory below the given root; the signals of all
+ * jobs are forwarded with the job id, on the thread the engine lives in.
+ *
+ * Disk bound phases (saving downloads, copying and hashing release files)
+ * run on a small pool of their own and CPU bound ones (extraction and the
+ * packaging script) on a pool sized to the machine, so one job's copy
+ * overlaps another job's extraction instead of both fighting for the disk.
+ *
+ * A finished job stays available through job() until takeJob() hands it
+ * over to the caller, who then owns it.
+ */
+class IngestEngine : public QObject
+{
+    Q_OBJECT
+public:
+    IngestEngine(QString stagingRoot, QObject *parent = 0);
+    ~IngestEngine();
+    int submit(IngestJob::request request);
+    IngestJob *job(int id) const;
+    IngestJob *takeJob(int id);
+signals:
+    void stageChanged(int id, int stage);
+    void progress(int id, qint64 done, qint64 total);
+    void logMessage(int id, QString text);
+    void jobFinished(int id, bool success);
+private slots:
+    void onPhaseFinished(int id);
+private:
+    void schedule(IngestJob *job);
+    QString m_stagingRoot;
+    QThreadPool m_diskPool;
+    QThreadPool m_cpuPool;
+    QHash<int, IngestJob*> m_jobs;
+    int m_nextId;
+};
+
+#endif // INGESTENGINE_H
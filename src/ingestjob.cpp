@@ -0,0 +1,599 @@
+/**
+ ******************************************************************************
+ * @file       ingestjob.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestJob
+ * @{
+ * @brief Processes a downloaded package into a release item off the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "ingestjob.h"
+#include <QCryptographicHash>
+#include <QProcess>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+
+#define IO_CHUNK_SIZE (1024 * 1024)
+
+IngestJob::IngestJob(int id, IngestJob::request jobRequest, QObject *parent) : QObject(parent), m_id(id), m_request(jobRequest), m_stage(STAGE_QUEUED), m_phase(PHASE_SAVE)
+{
+    setAutoDelete(false);
+}
+
+int IngestJob::id() const
+{
+    return m_id;
+}
+
+QString IngestJob::name() const
+{
+    if(m_request.name.isEmpty())
+        return QFileInfo(m_request.packagePath).fileName();
+    return m_request.name;
+}
+
+// The items created, each with the directory holding its release files.
+// Only valid once finished() was emitted.
+QList<IngestJob::output> IngestJob::outputs() const
+{
+    return m_outputs;
+}
+
+QString IngestJob::releaseDir(int index) const
+{
+    return m_request.stagingDir + "releases" + QString::number(index);
+}
+
+QString IngestJob::stagingDir() const
+{
+    return m_request.stagingDir;
+}
+
+QString IngestJob::stageToString(IngestJob::stageEnum stage)
+{
+    switch (stage) {
+    case STAGE_QUEUED:
+        return "queued";
+    case STAGE_SAVING:
+        return "saving download";
+    case STAGE_EXTRACTING:
+        return "decompressing";
+    case STAGE_CHECKING:
+        return "checking contents";
+    case STAGE_READING_INFO:
+        return "processing INFO file";
+    case STAGE_PACKAGING:
+        return "running packaging script";
+    case STAGE_COPYING:
+        return "copying release files";
+    case STAGE_HASHING:
+        return "calculating MD5";
+    case STAGE_DONE:
+        return "done";
+    case STAGE_FAILED:
+        return "failed";
+    }
+    return "unknown";
+}
+
+IngestJob::phaseEnum IngestJob::phase() const
+{
+    return m_phase;
+}
+
+bool IngestJob::isDiskBound(IngestJob::phaseEnum phase)
+{
+    return phase != PHASE_PROCESS;
+}
+
+void IngestJob::run()
+{
+    bool success = false;
+    switch (m_phase) {
+    case PHASE_SAVE:
+        QDir().mkpath(m_request.stagingDir);
+        success = savePackage();
+        break;
+    case PHASE_PROCESS:
+        success = processPackage();
+        break;
+    case PHASE_STAGE:
+        success = m_request.bundle ? stageBundle() : stageRelease();
+        break;
+    }
+    if(success && m_phase != PHASE_STAGE) {
+        m_phase = (phaseEnum)(m_phase + 1);
+        emit phaseFinished(m_id);
+        return;
+    }
+    setStage(success ? STAGE_DONE : STAGE_FAILED);
+    emit finished(m_id, success);
+}
+
+QString IngestJob::extractedPath() const
+{
+    QString extractedPath = m_request.stagingDir + QFileInfo(m_request.packagePath).fileName();
+    extractedPath = extractedPath.remove(".exe").remove(".tar.xz").remove(".zip").remove(".tar.gz");
+    extractedPath += QDir::separator();
+    return extractedPath;
+}
+
+// Extraction, content checks and the packaging script
+bool IngestJob::processPackage()
+{
+    QString extractedPath = this->extractedPath();
+    if((m_request.type != xmlParser::SOFT_SETTINGS) && (m_request.type != xmlParser::SOFT_UPDATER)) {
+        setStage(STAGE_EXTRACTING);
+        log("Decompressing downloaded file");
+        QStringList arguments;
+        arguments << "-xvf";
+        arguments << m_request.packagePath;
+        arguments << "-C";
+        arguments << m_request.stagingDir;
+        if(!runProcess("tar", arguments)) {
+            log("Decompression FAILED");
+            return false;
+        }
+        log("File decompressed to " + extractedPath);
+    }
+    setStage(STAGE_CHECKING);
+    if(m_request.bundle ? !scanBundle(extractedPath) : !checkContents(extractedPath))
+        return false;
+    //only if not updater binary or settings file
+    if((m_request.type != xmlParser::SOFT_UPDATER) && (m_request.type != xmlParser::SOFT_SETTINGS)) {
+        setStage(STAGE_READING_INFO);
+        if(!readBuildInfo(extractedPath))
+            return false;
+        if(m_request.osType != xmlParser::OS_EMBEDED) {
+            setStage(STAGE_PACKAGING);
+            QStringList arguments;
+            arguments << m_request.rubyScriptPath << "-p" << QString(m_request.osName).remove(" ") << "-v" << "0" << "-u" << m_request.updaterBinaryPath;
+            arguments << extractedPath << m_request.updaterScriptPath << "./currentbuild";
+            log(QString("Running ruby script with command:ruby %0").arg(arguments.join(" ")));
+            if(!runProcess("ruby", arguments)) {
+                log("Packaging script FAILED");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Copies the release files to their final names and hashes them
+bool IngestJob::stageRelease()
+{
+    QString extractedPath = this->extractedPath();
+    setStage(STAGE_COPYING);
+    QString releasePartialPath;
+    releasePartialPath = m_request.osName + QDir::separator();
+    if(m_request.osType != xmlParser::OS_EMBEDED && m_request.type != xmlParser::SOFT_UPDATER) {
+        releasePartialPath += m_request.typeName;
+    }
+    else if (m_request.type != xmlParser::SOFT_UPDATER){
+        releasePartialPath += m_request.hwName.toLower();
+    }
+    QString releaseStoragePath = releaseDir(0) + QDir::separator();
+    QDir().mkpath(releaseStoragePath);
+    QString serverStoragePath = this->serverStoragePath(releasePartialPath);
+    log(QString("Setting %0 to %1").arg("releaseStoragePath").arg(releaseStoragePath));
+
+    QString date = m_result.date.toString("yyyyMMdd");
+    QString hwDir = m_request.hwName.toLower();
+    QString file;
+    QString source, destination;
+    bool result = false;
+    switch (m_request.type) {
+    case xmlParser::SOFT_BOOTLOADER:
+        file = QString("bu_%0_%1.tlfw").arg(date).arg(m_gitHash);
+        m_result.releaseLink = serverStoragePath + file;
+        source = QString(extractedPath + "flight" + QDir::separator() + hwDir + QDir::separator() + "bu_%0.tlfw").arg(hwDir);
+        destination = releaseStoragePath + file;
+        result = copyRelease(source, destination);
+        break;
+    case xmlParser::SOFT_FIRMWARE:
+        file = QString("fw_%0_%1.tlfw").arg(date).arg(m_gitHash);
+        m_result.releaseLink = serverStoragePath + file;
+        source = QString(extractedPath + "flight" + QDir::separator() + hwDir + QDir::separator() + "fw_%0.tlfw").arg(hwDir);
+        destination = releaseStoragePath + file;
+        result = copyRelease(source, destination);
+        break;
+    case xmlParser::SOFT_SETTINGS:
+        file = QString( "settings_%0_%1.xml").arg(date).arg(m_gitHash);
+        m_result.releaseLink = serverStoragePath + file;
+        source = m_request.packagePath;
+        destination = releaseStoragePath + file;
+        result = copyRelease(source, destination);
+        break;
+    case xmlParser::SOFT_GCS:
+    case xmlParser::SOFT_SLIM_GCS:
+        file = QString("%0_%1.zip").arg(date).arg(m_gitHash);
+        m_result.releaseLink = serverStoragePath + file;
+        source = QString(m_request.stagingDir + "currentbuild" + QDir::separator() + "app.zip");
+        destination = releaseStoragePath + file;
+        result = copyRelease(source, destination);
+        file = QString("%0_%1.xml").arg(date).arg(m_gitHash);
+        m_result.scriptLink = serverStoragePath + file;
+        source = QString(m_request.stagingDir + "currentbuild" + QDir::separator() + "file_list.xml");
+        result &= QFile::copy(source, releaseStoragePath + file);
+        log(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(releaseStoragePath + file).arg(result));
+        break;
+    case xmlParser::SOFT_UPDATER:
+        switch (m_request.osType) {
+        case xmlParser::OS_LINUX32:
+        case xmlParser::OS_LINUX64:
+            file = QString("updater");
+            m_result.releaseLink = serverStoragePath + file;
+            source = m_request.packagePath;
+            destination = releaseStoragePath + file;
+            result = copyRelease(source, destination);
+            break;
+            //TODO
+        default:
+            log("Updater packages are only supported for linux");
+            break;
+        }
+        break;
+    }
+    if(!result) {
+        log("Release packages copy FAILED");
+        return false;
+    }
+    setStage(STAGE_HASHING);
+    m_result.md5 = hashFile(destination);
+    if(m_result.md5.isEmpty())
+        return false;
+    m_result.hwType = m_request.hwType;
+    m_result.name = m_request.name;
+    m_result.osType = m_request.osType;
+    m_result.packageLink = m_request.packageLink;
+    m_result.type = m_request.type;
+    output out;
+    out.item = m_result;
+    out.releaseDir = releaseDir(0);
+    m_outputs.append(out);
+    log("Release packages copied to local temp directory");
+    return true;
+}
+
+QString IngestJob::serverStoragePath(QString releasePartialPath)
+{
+    releasePartialPath = releasePartialPath.remove(" ");
+    QString serverStoragePath = m_request.serverPath + releasePartialPath + QDir::separator();
+    serverStoragePath = serverStoragePath.replace(QString("%0%1").arg(QDir::separator()).arg(QDir::separator()), QDir::separator());
+    log(QString("Setting %0 to %1").arg("releasePartialPath").arg(releasePartialPath));
+    log(QString("Setting %0 to %1").arg("serverStoragePath").arg(serverStoragePath));
+    return serverStoragePath;
+}
+
+// Lists flight/ once and picks up the firmware and bootloader image of every
+// known board found there
+bool IngestJob::scanBundle(QString extractedPath)
+{
+    log("Looking for board images in the bundle");
+    QHash<QString, int> boards;
+    foreach (int hwType, xmlParser::hwTypeToStringHash.keys()) {
+        if(hwType != 0)
+            boards.insert(xmlParser::hwTypeToStringHash.value(hwType).toLower(), hwType);
+    }
+    QString flightPath = extractedPath + "flight" + QDir::separator();
+    m_images.clear();
+    foreach (QString dir, QDir(flightPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+        if(!boards.contains(dir.toLower()))
+            continue;
+        int hwType = boards.value(dir.toLower());
+        QStringList files = QDir(flightPath + dir).entryList(QDir::Files);
+        image img;
+        img.hwType = hwType;
+        img.hwName = xmlParser::hwTypeToStringHash.value(hwType);
+        if(files.contains(QString("fw_%0.tlfw").arg(dir))) {
+            img.type = xmlParser::SOFT_FIRMWARE;
+            img.source = flightPath + dir + QDir::separator() + QString("fw_%0.tlfw").arg(dir);
+            m_images.append(img);
+        }
+        if(files.contains(QString("bu_%0.tlfw").arg(dir))) {
+            img.type = xmlParser::SOFT_BOOTLOADER;
+            img.source = flightPath + dir + QDir::separator() + QString("bu_%0.tlfw").arg(dir);
+            m_images.append(img);
+        }
+    }
+    foreach (image img, m_images) {
+        log(QString("Found %0 for %1").arg(xmlParser::softTypeToString(img.type)).arg(img.hwName));
+    }
+    if(m_images.isEmpty()) {
+        log("FAILED to find any board image in the bundle, ABORTING!");
+        return false;
+    }
+    return true;
+}
+
+// Copies every image found by scanBundle() to a release directory of its own
+// and creates its item. The images are hashed one after the other on this
+// disk pool thread, so a bundle doesn't take more of the disk than DISK_THREADS
+// allow
+bool IngestJob::stageBundle()
+{
+    setStage(STAGE_COPYING);
+    QString date = m_result.date.toString("yyyyMMdd");
+    QStringList destinations;
+    for(int x = 0; x < m_images.count(); ++x) {
+        const image &img = m_images.at(x);
+        QString file = QString("%0_%1_%2.tlfw").arg(img.type == xmlParser::SOFT_FIRMWARE ? "fw" : "bu").arg(date).arg(m_gitHash);
+        QString releaseStoragePath = releaseDir(x) + QDir::separator();
+        QDir().mkpath(releaseStoragePath);
+        if(!copyRelease(img.source, releaseStoragePath + file)) {
+            log("Release packages copy FAILED");
+            return false;
+        }
+        destinations.append(releaseStoragePath + file);
+        output out;
+        out.item = m_result;
+        out.item.releaseLink = serverStoragePath(m_request.osName + QDir::separator() + img.hwName.toLower()) + file;
+        out.item.hwType = img.hwType;
+        out.item.name = m_request.name;
+        out.item.osType = xmlParser::OS_EMBEDED;
+        out.item.packageLink = m_request.packageLink;
+        out.item.type = img.type;
+        out.releaseDir = releaseDir(x);
+        m_outputs.append(out);
+    }
+    setStage(STAGE_HASHING);
+    for(int x = 0; x < destinations.count(); ++x) {
+        m_outputs[x].item.md5 = hashFile(destinations.at(x));
+        if(m_outputs.at(x).item.md5.isEmpty()) {
+            m_outputs.clear();
+            return false;
+        }
+    }
+    log(QString("%0 release packages copied to local temp directory").arg(m_outputs.count()));
+    return true;
+}
+
+// Writes the downloaded data next to the other downloads, through a
+// temporary name so a job reading the same package never sees half of it
+bool IngestJob::savePackage()
+{
+    m_result.date = m_request.date;
+    m_result.uavHash = m_request.uavHash;
+    if(m_request.packageData.isEmpty())
+        return true;
+    setStage(STAGE_SAVING);
+    log(QString("Saving downloaded file to %0").arg(m_request.packagePath));
+    QDir().mkpath(QFileInfo(m_request.packagePath).path());
+    QString partial = m_request.packagePath + QString(".part%0").arg(m_id);
+    QFile localFile(partial);
+    if(!localFile.open(QIODevice::WriteOnly)) {
+        log("Failed to save downloaded file");
+        return false;
+    }
+    qint64 total = m_request.packageData.size();
+    for(qint64 written = 0; written < total; written += IO_CHUNK_SIZE) {
+        if(localFile.write(m_request.packageData.constData() + written, qMin<qint64>(IO_CHUNK_SIZE, total - written)) == -1) {
+            log("Failed to save downloaded file");
+            localFile.remove();
+            return false;
+        }
+        emit progress(m_id, qMin<qint64>(written + IO_CHUNK_SIZE, total), total);
+    }
+    localFile.close();
+    m_request.packageData.clear();
+    // another job may have saved the same package meanwhile
+    if(QFile::exists(m_request.packagePath))
+        QFile::remove(partial);
+    else if(!QFile::rename(partial, m_request.packagePath)) {
+        log("Failed to save downloaded file");
+        return false;
+    }
+    return true;
+}
+
+// Runs program in the staging directory, forwarding its output as log lines
+bool IngestJob::runProcess(QString program, QStringList arguments)
+{
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.setWorkingDirectory(m_request.stagingDir);
+    process.start(program, arguments);
+    if(!process.waitForStarted(-1)) {
+        log(QString("Could not start %0").arg(program));
+        return false;
+    }
+    while(process.waitForReadyRead(-1)) {
+        QByteArray array = process.readAll();
+        if(!array.isEmpty())
+            log(QString::fromLocal8Bit(array).trimmed());
+    }
+    process.waitForFinished(-1);
+    QByteArray array = process.readAll();
+    if(!array.isEmpty())
+        log(QString::fromLocal8Bit(array).trimmed());
+    if(process.exitStatus() != QProcess::NormalExit)
+        return false;
+    if(process.exitCode() != 0) {
+        log(QString("%0 exited with code %1").arg(program).arg(process.exitCode()));
+        return false;
+    }
+    return true;
+}
+
+bool IngestJob::checkContents(QString extractedPath)
+{
+    log("Checking if downloaded file has the necessary files");
+    QString completePath = m_request.packagePath;
+    QString hw = m_request.hwName.toLower();
+    bool condition1 = false;
+    bool condition2 = false;
+    QString condition1_text;
+    QString condition2_text;
+    switch (m_request.osType) {
+    case xmlParser::OS_LINUX64:
+    case xmlParser::OS_LINUX32:
+        switch (m_request.type) {
+        case xmlParser::SOFT_SLIM_GCS:
+            condition1 = QDir(extractedPath + "slimgcs").exists();
+            condition1_text = "Directory slimgcs exists";
+            condition2 = QFileInfo(extractedPath + "tbsagent").isSymLink();//TODO
+            condition2_text = "Symlink to slimgcs binary exists";
+            break;
+        case xmlParser::SOFT_GCS:
+            condition1 = QDir(extractedPath + "gcs").exists();
+            condition1_text = "Directory gcs exists";
+            condition2 = QFileInfo(extractedPath + "taulabsgcs").isSymLink();
+            condition2_text = "Symlink to taulabsgcs binary exists";
+        case xmlParser::SOFT_UPDATER:
+            condition2 = QFile(completePath).exists();
+            condition2_text = completePath + "exists";
+            condition1 = true;
+            condition1_text = "";
+        default:
+            break;
+        }
+        break;
+    case xmlParser::OS_OSX64:
+    case xmlParser::OS_OSX32:
+        //TODO
+        break;
+    case xmlParser::OS_WIN64:
+    case xmlParser::OS_WIN32:
+        //TODO
+        break;
+    case xmlParser::OS_EMBEDED:
+        switch (m_request.type) {
+        case xmlParser::SOFT_FIRMWARE:
+            condition2_text = extractedPath + "flight" + QString(QDir::separator()) + hw + QString(QDir::separator()) + QString("fw_%0.tlfw").arg(hw);
+            condition2 = QFile(condition2_text).exists();
+            condition2_text += " exists on the extracted directory";
+            condition1 = true;
+            condition1_text = "";
+            break;
+        case xmlParser::SOFT_BOOTLOADER:
+            condition2_text = extractedPath + "flight" + QString(QDir::separator()) + hw + QString(QDir::separator()) + QString("bu_%0.tlfw").arg(hw);
+            condition2 = QFile(condition2_text).exists();
+            condition2_text += " exists on the extracted directory";
+            condition1 = true;
+            condition1_text = "";
+            break;
+        case xmlParser::SOFT_SETTINGS:
+            condition1 = QFile(completePath).exists();
+            condition1_text = completePath + " exists";
+            condition2 = true;
+        default:
+            condition1 = true;
+            condition2 = true;
+            break;
+        }
+    default:
+        break;
+    }
+    if(!condition1_text.isEmpty())
+        log(QString("%0? = %1").arg(condition1_text).arg(condition1 ? "SUCCESS" : "FAILED"));
+    if(!condition2_text.isEmpty())
+        log(QString("%0? = %1").arg(condition2_text).arg(condition2 ? "SUCCESS" : "FAILED"));
+    if(!condition1 || !condition2) {
+        log("FAILED to find required files, ABORTING!");
+        return false;
+    }
+    return true;
+}
+
+bool IngestJob::readBuildInfo(QString extractedPath)
+{
+    log("Processing INFO file");
+    QFile infoFile(extractedPath + "BUILD_INFO");
+    if(!infoFile.open(QIODevice::ReadOnly)) {
+        log("FAILED to open INFO file");
+        return false;
+    }
+    QTextStream in(&infoFile);
+    QString tagStr, valueStr;
+    while (!in.atEnd())
+    {
+        QString line = in.readLine();
+        QStringList l = line.split("=");
+        if(l.length() == 2)
+        {
+            if(l.at(0) == "BRANCH") {
+            }
+            else if(l.at(0) == "GIT_HASH") {
+                m_gitHash = l.at(1);
+                tagStr = "gitHash";
+                valueStr = m_gitHash;
+            }
+            else if(l.at(0) == "DATE") {
+                m_result.date = QDate::fromString(l.at(1), "yyyyMMdd");
+                tagStr = "Date";
+                valueStr = l.at(1);
+            }
+            else if(l.at(0) == "UAVO_HASH") {
+                QString temp;
+                temp = l.at(1);
+                temp = temp.remove(",").remove("0x");
+                m_result.uavHash = temp;
+                tagStr = "UAVO Hash";
+                valueStr = temp;
+            }
+            log(QString("Info file says %0=%1").arg(tagStr).arg(valueStr));
+        }
+    }
+    log("Done processing INFO file");
+    return true;
+}
+
+bool IngestJob::copyRelease(QString source, QString destination)
+{
+    bool result = QFile::copy(source, destination);
+    log(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(result));
+    return result;
+}
+
+QString IngestJob::hashFile(QString filename)
+{
+    log(QString("Calculating MD5 of %0").arg(filename));
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        log("Could not open file to calculate MD5");
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    qint64 total = file.size();
+    qint64 done = 0;
+    QByteArray chunk;
+    while(!(chunk = file.read(IO_CHUNK_SIZE)).isEmpty()) {
+        hash.addData(chunk);
+        done += chunk.size();
+        emit progress(m_id, done, total);
+    }
+    QString ret = QString(hash.result().toHex());
+    log(QString("MD5=%0").arg(ret));
+    return ret;
+}
+
+void IngestJob::setStage(IngestJob::stageEnum stage)
+{
+    m_stage = stage;
+    emit stageChanged(m_id, stage);
+}
+
+void IngestJob::log(QString text)
+{
+    emit logMessage(m_id, text);
+}
@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * @file       ingestjob.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup IngestJob
+ * @{
+ * @brief Processes a downloaded package into a release item off the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef INGESTJOB_H
+#define INGESTJOB_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QDate>
+#include "xmlparser.h"
+
+/**
+ * One package going through the steps that turn it into a release item:
+ * saving the download, extracting it, checking its contents, reading
+ * BUILD_INFO, running the packaging script, copying the release files and
+ * hashing them.
+ *
+ * Jobs run on worker threads of IngestEngine and never touch the UI; all
+ * they need is copied into the request, and stage, progress and console
+ * lines are reported through signals. Every job works in its own staging
+ * directory, so any number of them can run at the same time.
+ *
+ * In bundle mode the package is a firmware bundle: every board image found
+ * under flight/ in one pass over the extracted tree becomes a firmware or
+ * bootloader item, and the images are hashed in parallel.
+ *
+ * The work is split in phases that are either disk or CPU bound; each
+ * run() executes one phase and phaseFinished() asks the engine to queue the
+ * job again for the next one, on the pool for that kind of work.
+ */
+class IngestJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    enum stageEnum {STAGE_QUEUED, STAGE_SAVING, STAGE_EXTRACTING, STAGE_CHECKING, STAGE_READING_INFO,
+                    STAGE_PACKAGING, STAGE_COPYING, STAGE_HASHING, STAGE_DONE, STAGE_FAILED};
+    enum phaseEnum {PHASE_SAVE, PHASE_PROCESS, PHASE_STAGE};
+    struct request
+    {
+        QString packageLink;
+        QString packagePath;
+        QByteArray packageData;
+        xmlParser::osTypeEnum osType;
+        QString osName;
+        xmlParser::softTypeEnum type;
+        QString typeName;
+        int hwType;
+        QString hwName;
+        QString name;
+        QDate date;
+        QString uavHash;
+        QString serverPath;
+        QString rubyScriptPath;
+        QString updaterScriptPath;
+        QString updaterBinaryPath;
+        QString stagingDir;
+        bool bundle;
+    };
+    struct output
+    {
+        xmlParser::softData item;
+        QString releaseDir;
+    };
+
+    IngestJob(int id, request jobRequest, QObject *parent = 0);
+    void run();
+    int id() const;
+    QString name() const;
+    QList<output> outputs() const;
+    QString stagingDir() const;
+    phaseEnum phase() const;
+    static bool isDiskBound(phaseEnum phase);
+    static QString stageToString(stageEnum stage);
+signals:
+    void stageChanged(int id, int stage);
+    void progress(int id, qint64 done, qint64 total);
+    void logMessage(int id, QString text);
+    void phaseFinished(int id);
+    void finished(int id, bool success);
+private:
+    bool processPackage();
+    bool stageRelease();
+    QString extractedPath() const;
+    QString releaseDir(int index) const;
+    QString serverStoragePath(QString releasePartialPath);
+    bool scanBundle(QString extractedPath);
+    bool stageBundle();
+    bool savePackage();
+    bool runProcess(QString program, QStringList arguments);
+    bool checkContents(QString extractedPath);
+    bool readBuildInfo(QString extractedPath);
+    bool copyRelease(QString source, QString destination);
+    QString hashFile(QString filename);
+    void setStage(stageEnum stage);
+    void log(QString text);
+    int m_id;
+    request m_request;
+    stageEnum m_stage;
+    phaseEnum m_phase;
+    QString m_gitHash;
+    xmlParser::softData m_result;
+    struct image
+    {
+        xmlParser::softTypeEnum type;
+        int hwType;
+        QString hwName;
+        QString source;
+    };
+    QList<image> m_images;
+    QList<output> m_outputs;
+};
+
+#endif // INGESTJOB_H
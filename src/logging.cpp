@@ -0,0 +1,38 @@
+/**
+ ******************************************************************************
+ * @file       logging.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup Logging
+ * @{
+ * @brief Logging categories of the application
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcParser, "releasebuilder.parser")
+Q_LOGGING_CATEGORY(lcFtp, "releasebuilder.ftp")
+Q_LOGGING_CATEGORY(lcIngest, "releasebuilder.ingest")
+
+// Rules from QT_LOGGING_RULES or a logging config file are applied after
+// these, so they can still enable any category
+void initLogging()
+{
+    QLoggingCategory::setFilterRules("releasebuilder.*.debug=false");
+}
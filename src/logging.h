@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * @file       logging.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup Logging
+ * @{
+ * @brief Logging categories of the application
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+/**
+ * Diagnostics go through these categories with qCDebug() and friends. A
+ * disabled category costs one flag test, the message is never formatted;
+ * release builds define QT_NO_DEBUG_OUTPUT and lose the debug statements
+ * altogether.
+ *
+ * Debug output is off by default, it is turned on at runtime with the usual
+ * rules, e.g. QT_LOGGING_RULES="releasebuilder.parser.debug=true".
+ */
+Q_DECLARE_LOGGING_CATEGORY(lcParser)
+Q_DECLARE_LOGGING_CATEGORY(lcFtp)
+Q_DECLARE_LOGGING_CATEGORY(lcIngest)
+
+void initLogging();
+
+#endif // LOGGING_H
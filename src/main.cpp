@@ -25,10 +25,12 @@
  */
 
 #include "mainwindow.h"
+#include "logging.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    initLogging();
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -29,38 +29,37 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "webfileutils.h"
+#include "logging.h"
 #include <QDebug>
 #include <QMessageBox>
 #include <QDir>
 #include <qftp.h>
 #include "ftpcredentials.h"
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QInputDialog>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow), releaseTable(NULL), oldReleaseTable(NULL)
+    ui(new Ui::MainWindow), releaseTable(NULL), oldReleaseTable(NULL), ingestBatch(NULL), showingSnapshot(false)
 {
     ui->setupUi(this);
-    //process used to run ruby script and tar
-    process = new QProcess(this);
-    eventLoop = new QEventLoop(this);
     ftp = new QFtp(this);
+    asyncFtp = new AsyncFtp(ftp, this);
+    ftpLoginResult = FtpFuture::succeeded();
+    buildIndexResult = FtpFuture::succeeded();
     fileUtils = new webFileUtils(this);
+    packageNetwork = new QNetworkAccessManager(this);
     settings = new Settings(this);
     parser = new xmlParser(this);
 
-    //text output channels
-    process->setProcessChannelMode(QProcess::MergedChannels);
-
-    connect(process, SIGNAL(readyReadStandardOutput()), this, SLOT(onReadyReadFromProcess()));
-    connect(process, SIGNAL(finished(int)), eventLoop, SLOT(quit()));
-
     connect(ftp, SIGNAL(stateChanged(int)), this, SLOT(onFtpStateChanged(int)));
-    connect(ftp, SIGNAL(commandFinished(int,bool)), SLOT(onFtpOperationEnded(int,bool)));
+    connect(asyncFtp, SIGNAL(operationFinished(QString,bool,QString)), this, SLOT(onFtpOperationFinished(QString,bool,QString)));
     connect(ftp, SIGNAL(dataTransferProgress(qint64,qint64)), this, SLOT(onFtpTransferProgress(qint64, qint64)));
-    connect(ftp, SIGNAL(listInfo(QUrlInfo)), this, SLOT(onftpListInfo(QUrlInfo)));
 
     connect(fileUtils, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
-    connect(fileUtils, SIGNAL(downloaded(bool,QByteArray,QString,QNetworkReply::NetworkError)), this, SLOT(onWebFileDownloaded(bool, QByteArray,QString,QNetworkReply::NetworkError)));
 
     connect(parser, SIGNAL(outputMessage(QString)), this, SLOT(onXMLParserMessage(QString)));
 
@@ -79,6 +78,8 @@ MainWindow::MainWindow(QWidget *parent) :
     //widgets signals connection
     connect(ui->fetchTB, SIGNAL(clicked()), this, SLOT(onFetchButtonPressed()));
     connect(ui->createItemTB, SIGNAL(clicked()), this, SLOT(onCreateItemButtonPressed()));
+    connect(ui->batchItemsTB, SIGNAL(clicked()), this, SLOT(onBatchItemsButtonPressed()));
+    connect(ui->buildServerTB, SIGNAL(clicked()), this, SLOT(onBuildServerButtonPressed()));
     connect(ui->processNewItemTB, SIGNAL(clicked()), this, SLOT(onProcessNewItemButtonPressed()));
     connect(ui->cancelNewItemTB, SIGNAL(clicked()), this, SLOT(onCancelNewItemButtonPressed()));
     connect(ui->settingsTB, SIGNAL(clicked()), this, SLOT(onSettingsButtonPressed()));
@@ -91,11 +92,25 @@ MainWindow::MainWindow(QWidget *parent) :
     processStatusChange(STATUS_IDLE);
     fillComboBoxes();
 
-    //delete /temp/realease_builder
-    QDir(QDir::temp().absolutePath() + QDir::separator() + "release_builder").removeRecursively();
-
     workingRoot = QDir::temp().absolutePath() + QDir::separator() + "release_builder" + QDir::separator();
 
+    //package processing runs on worker threads, every job in its own directory
+    ingestEngine = new IngestEngine(workingRoot + "jobs", this);
+    connect(ingestEngine, SIGNAL(stageChanged(int,int)), this, SLOT(onIngestStageChanged(int,int)));
+    connect(ingestEngine, SIGNAL(progress(int,qint64,qint64)), this, SLOT(onIngestProgress(int,qint64,qint64)));
+    connect(ingestEngine, SIGNAL(logMessage(int,QString)), this, SLOT(onIngestLogMessage(int,QString)));
+    connect(ingestEngine, SIGNAL(jobFinished(int,bool)), this, SLOT(onIngestJobFinished(int,bool)));
+
+    //delete /temp/realease_builder unless an interrupted push still needs its files
+    pushJournal = new PushJournal(QApplication::applicationDirPath() + QDir::separator() + "pushjournal.ini", this);
+    pushPlanner = new PushPlanner(QApplication::applicationDirPath() + QDir::separator() + "pushplanner.ini", this);
+    if(pushJournal->isPending())
+        QTimer::singleShot(0, this, SLOT(resumeInterruptedPush()));
+    else {
+        QDir(QDir::temp().absolutePath() + QDir::separator() + "release_builder").removeRecursively();
+        QTimer::singleShot(0, this, SLOT(loadCatalogSnapshot()));
+    }
+
 }
 
 MainWindow::~MainWindow()
@@ -109,29 +124,29 @@ void MainWindow::fillTable(TableWidgetData *tableData)
     table->clearContents();
     table->setRowCount(0);
     QTableWidgetItem *item;
-    table->setRowCount(tableData->dataActionPerItem.values().length());
+    table->setRowCount(tableData->items().count());
     int index = 0;
-    foreach (int x, tableData->dataActionPerItem.keys()) {
-        item = new QTableWidgetItem(xmlParser::softTypeToString(tableData->dataActionPerItem.value(x).data.type), 0);
+    foreach (int x, tableData->items().keys()) {
+        item = new QTableWidgetItem(xmlParser::softTypeToString(tableData->item(x).data.type), 0);
         item->setData(Qt::UserRole, x);
         table->setItem(index, 0, item);
-        table->setItem(index, 2, new QTableWidgetItem(QString::number(tableData->dataActionPerItem.value(x).data.hwType), 0));
-        table->setItem(index, 9, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.md5), 0));
-        table->setItem(index, 4, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.name), 0));
-        table->setItem(index, 1, new QTableWidgetItem((xmlParser::osTypeToString(tableData->dataActionPerItem.value(x).data.osType)), 0));
-        table->setItem(index, 5, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.packageLink.toString()), 0));
-        table->setItem(index, 6, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.releaseLink.toString()), 0));
-        table->setItem(index, 7, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.scriptLink.toString()), 0));
-        table->setItem(index, 3, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.date.toString()), 0));
-        table->setItem(index, 8, new QTableWidgetItem((tableData->dataActionPerItem.value(x).data.uavHash), 0));
+        table->setItem(index, 2, new QTableWidgetItem(QString::number(tableData->item(x).data.hwType), 0));
+        table->setItem(index, 9, new QTableWidgetItem((tableData->item(x).data.md5), 0));
+        table->setItem(index, 4, new QTableWidgetItem((tableData->item(x).data.name), 0));
+        table->setItem(index, 1, new QTableWidgetItem((xmlParser::osTypeToString(tableData->item(x).data.osType)), 0));
+        table->setItem(index, 5, new QTableWidgetItem((tableData->item(x).data.packageLink.toString()), 0));
+        table->setItem(index, 6, new QTableWidgetItem((tableData->item(x).data.releaseLink.toString()), 0));
+        table->setItem(index, 7, new QTableWidgetItem((tableData->item(x).data.scriptLink.toString()), 0));
+        table->setItem(index, 3, new QTableWidgetItem((tableData->item(x).data.date.toString()), 0));
+        table->setItem(index, 8, new QTableWidgetItem((tableData->item(x).data.uavHash), 0));
         QColor color;
-        if(tableData->dataActionPerItem.value(x).action == TableWidgetData::ACTION_CHANGED_METADATA)
+        if(tableData->item(x).action == TableWidgetData::ACTION_CHANGED_METADATA)
             color = Qt::yellow;
-        else if(tableData->dataActionPerItem.value(x).action == TableWidgetData::ACTION_COPY_TO_SERVER)
+        else if(tableData->item(x).action == TableWidgetData::ACTION_COPY_TO_SERVER)
             color = Qt::green;
-        else if(tableData->dataActionPerItem.value(x).action == TableWidgetData::ACTION_DELETE_FROM_SERVER)
+        else if(tableData->item(x).action == TableWidgetData::ACTION_DELETE_FROM_SERVER)
             color = Qt::red;
-        if(tableData->dataActionPerItem.value(x).action != TableWidgetData::ACTION_NONE) {
+        if(tableData->item(x).action != TableWidgetData::ACTION_NONE) {
             for(int y = 0; y < table->columnCount(); ++y) {
                 table->item(index, y)->setBackground(color);
             }
@@ -140,40 +155,14 @@ void MainWindow::fillTable(TableWidgetData *tableData)
     }
 }
 
-int MainWindow::getFirstFreeIndex(TableWidgetData *data)
-{
-    int x = 0;
-    bool found = false;
-    do
-    {
-        if(!data->dataActionPerItem.keys().contains(x))
-            found = true;
-        else
-            x = x + 1;
-    } while(!found);
-    return x;
-}
-
-int MainWindow::getFirstFreeIndex(QHash<int, TableWidgetData::dataActionStruct> &data)
-{
-    int x = 0;
-    bool found = false;
-    do
-    {
-        if(!data.keys().contains(x))
-            found = true;
-        else
-            x = x + 1;
-    } while(!found);
-    return x;
-}
-
 void MainWindow::processStatusChange(MainWindow::status newStatus)
 {
     switch (newStatus) {
     case STATUS_IDLE:
         ui->fetchTB->setEnabled(true);
         ui->createItemTB->setEnabled(false);
+        ui->batchItemsTB->setEnabled(false);
+        ui->buildServerTB->setEnabled(false);
         ui->fetchTB->setEnabled(true);
         ui->deleteTB->setEnabled(false);
         ui->makeReleaseTB->setEnabled(true);
@@ -183,8 +172,11 @@ void MainWindow::processStatusChange(MainWindow::status newStatus)
     case STATUS_EDITING_RELEASE:
         ui->fetchTB->setEnabled(true);
         ui->deleteTB->setEnabled(true);
-        ui->pushTB->setEnabled(true);
+        //a catalog from the local copy is only pushed once the server confirmed it
+        ui->pushTB->setEnabled(!showingSnapshot);
         ui->createItemTB->setEnabled(true);
+        ui->batchItemsTB->setEnabled(true);
+        ui->buildServerTB->setEnabled(true);
         ui->makeReleaseTB->setEnabled(true);
         ui->createItemFrame->setVisible(false);
         break;
@@ -193,6 +185,8 @@ void MainWindow::processStatusChange(MainWindow::status newStatus)
         ui->deleteTB->setEnabled(false);
         ui->pushTB->setEnabled(false);
         ui->createItemTB->setEnabled(false);
+        ui->batchItemsTB->setEnabled(false);
+        ui->buildServerTB->setEnabled(false);
         ui->makeReleaseTB->setEnabled(false);
         ui->createItemFrame->setVisible(true);
         ui->dateEdit->setDateTime(QDateTime::currentDateTime());
@@ -204,6 +198,19 @@ void MainWindow::processStatusChange(MainWindow::status newStatus)
         ui->deleteTB->setEnabled(false);
         ui->pushTB->setEnabled(false);
         ui->createItemTB->setEnabled(false);
+        ui->batchItemsTB->setEnabled(false);
+        ui->buildServerTB->setEnabled(false);
+        ui->makeReleaseTB->setEnabled(false);
+        ui->createItemFrame->setVisible(false);
+        oldStatus = currentStatus;
+        break;
+    case STATUS_PUSHING:
+        ui->fetchTB->setEnabled(false);
+        ui->deleteTB->setEnabled(false);
+        ui->pushTB->setEnabled(false);
+        ui->createItemTB->setEnabled(false);
+        ui->batchItemsTB->setEnabled(false);
+        ui->buildServerTB->setEnabled(false);
         ui->makeReleaseTB->setEnabled(false);
         ui->createItemFrame->setVisible(false);
         oldStatus = currentStatus;
@@ -213,6 +220,8 @@ void MainWindow::processStatusChange(MainWindow::status newStatus)
         ui->deleteTB->setEnabled(false);
         ui->pushTB->setEnabled(false);
         ui->createItemTB->setEnabled(false);
+        ui->batchItemsTB->setEnabled(false);
+        ui->buildServerTB->setEnabled(false);
         ui->makeReleaseTB->setEnabled(false);
         ui->createItemFrame->setVisible(false);
         break;
@@ -265,51 +274,39 @@ int MainWindow::addNewItem(xmlParser::softData data)
 {
     ui->console->append(QString("Adding new item %0").arg(data.name));
     QList<int> repeated;
+    QString sameAs;
     switch (data.type) {
     case xmlParser::SOFT_BOOTLOADER:
     case xmlParser::SOFT_FIRMWARE:
-        foreach (int i, testReleaseTable->dataActionPerItem.keys()) {
-            if(data.hwType == testReleaseTable->dataActionPerItem.value(i).data.hwType && testReleaseTable->dataActionPerItem.value(i).data.type == data.type) {
-                ui->console->append(QString("Found repeated (hw and type are the same) item %0").arg(testReleaseTable->dataActionPerItem.value(i).data.name));
-                repeated.append(i);
-            }
-        }
+        sameAs = "hw and type are the same";
+        repeated = testReleaseTable->withTarget(TableWidgetData::targetOf(data));
         break;
     case xmlParser::SOFT_UPDATER:
     case xmlParser::SOFT_GCS:
     case xmlParser::SOFT_SLIM_GCS:
-        foreach (int i, testReleaseTable->dataActionPerItem.keys()) {
-            if(data.osType == testReleaseTable->dataActionPerItem.value(i).data.osType && testReleaseTable->dataActionPerItem.value(i).data.type == data.type) {
-                ui->console->append(QString("Found repeated (OS and type are the same) item %0").arg(testReleaseTable->dataActionPerItem.value(i).data.name));
-                repeated.append(i);
-            }
-        }
+        sameAs = "OS and type are the same";
+        repeated = testReleaseTable->withTarget(TableWidgetData::targetOf(data));
         break;
     default:
         break;
     }
-    if(repeated.length() > 0) {
-        foreach (int i, repeated) {
-            if(testReleaseTable->dataActionPerItem.value(i).action == TableWidgetData::ACTION_NONE) {
-                TableWidgetData::dataActionStruct temp;
-                temp.data = testReleaseTable->dataActionPerItem.value(i).data;
-                temp.action = TableWidgetData::ACTION_DELETE_FROM_SERVER;
-                testReleaseTable->dataActionPerItem.insert(i, temp);
-                ui->console->append(QString("Item %0 marked for deletion from server").arg(testReleaseTable->dataActionPerItem.value(i).data.name));
-            }
-            else if(testReleaseTable->dataActionPerItem.value(i).action == TableWidgetData::ACTION_COPY_TO_SERVER) {
-                ui->console->append(QString("Item %0 removed from list").arg(testReleaseTable->dataActionPerItem.value(i).data.name));
-                testReleaseTable->dataActionPerItem.remove(i);
-            }
+    foreach (int i, repeated) {
+        QString name = testReleaseTable->item(i).data.name;
+        ui->console->append(QString("Found repeated (%0) item %1").arg(sameAs).arg(name));
+        if(testReleaseTable->item(i).action == TableWidgetData::ACTION_NONE) {
+            testReleaseTable->setAction(i, TableWidgetData::ACTION_DELETE_FROM_SERVER);
+            ui->console->append(QString("Item %0 marked for deletion from server").arg(name));
+        }
+        else if(testReleaseTable->item(i).action == TableWidgetData::ACTION_COPY_TO_SERVER) {
+            ui->console->append(QString("Item %0 removed from list").arg(name));
+            testReleaseTable->remove(i);
         }
     }
     TableWidgetData::dataActionStruct temp;
     temp.data = data;
     temp.action = TableWidgetData::ACTION_COPY_TO_SERVER;
-    int newIndex = getFirstFreeIndex(testReleaseTable);
-    testReleaseTable->dataActionPerItem.insert(newIndex, temp);
+    int newIndex = testReleaseTable->insert(temp);
     this->fillTable(testReleaseTable);
-    processStatusChange(oldStatus);
     return newIndex;
 }
 
@@ -317,29 +314,45 @@ void MainWindow::onFetchButtonPressed()
 {
     ui->console->append(QString("Starting INFO file %0 download").arg(settings->settings.infoReleaseFilename));
     if(settings->settings.infoUseFtp) {
-        if(!ftpLogin())
-            return;
-        QString file = settings->settings.infoPath + settings->settings.infoReleaseFilename;
-        processStatusChange(STATUS_FETCHING_INFO_FILE);
-        int ftpOpId = ftp->get(file);
-        ftpOperations.insert(ftpOpId, QString("Fetching file %0").arg(file));
-        ftpDownloads.append(ftpOpId);
+        ftpLogin().onFinished([this](const FtpFuture &login) {
+            if(login.isSuccess())
+                fetchAndShowInformationFile();
+        });
     }
     else {
-        processStatusChange(STATUS_FETCHING_INFO_FILE);
-        QString file;
-        if(!settings->settings.infoPath.endsWith("/"))
-            file = settings->settings.infoPath + "/" + settings->settings.infoReleaseFilename;
-        else
-            file = settings->settings.infoPath + settings->settings.infoReleaseFilename;
-        QString user;
-        if(settings->settings.infoUseFtp)
-            user = settings->settings.ftpUserName + "@";
-        ui->console->append(QString("Downloading from %0%1").arg(user).arg(file));
-        fileUtils->startFileDownload(QUrl(file));
+        ui->console->append(QString("Downloading from %0").arg(informationFileLink()));
+        fetchAndShowInformationFile();
     }
 }
 
+// The file is parsed while it downloads, the tables are only replaced once
+// all of it was read and found valid
+void MainWindow::fetchAndShowInformationFile()
+{
+    processStatusChange(STATUS_FETCHING_INFO_FILE);
+    QSharedPointer<CatalogReader> reader(new CatalogReader);
+    fetchInformationFile(reader).onFinished([this, reader](const FtpFuture &result) {
+        bool missing = false;
+        if(!result.isSuccess()) {
+            ui->console->append("File download failed with error:" + result.errorString());
+            missing = settings->settings.infoUseFtp || result.replyCode() == 404;
+        }
+        else if(reader->size() == 0)
+            missing = true;
+        else {
+            ui->console->append("File download succeded");
+            processStatusChange(STATUS_PARSING_INFO_FILE);
+            if(!showInformationFile(*reader, result.value().toString()))
+                processStatusChange(oldStatus);
+            return;
+        }
+        if(missing && QMessageBox::question(this, "Information file apears not to exist on the server", "Do you want to create one?") == QMessageBox::Yes)
+            processStatusChange(STATUS_NEW_SYSTEM);
+        else
+            processStatusChange(oldStatus);
+    });
+}
+
 
 
 void MainWindow::fillComboBoxes()
@@ -361,24 +374,6 @@ void MainWindow::fillComboBoxes()
     }
 }
 
-QString MainWindow::calculateMD5(QString filename)
-{
-    ui->console->append(QString("Calculating MD5 of %0").arg(filename));
-    QFile file(filename);
-    if(file.open(QIODevice::ReadOnly)) {
-        QString ret = QString(QCryptographicHash::hash((file.readAll()),QCryptographicHash::Md5).toHex());
-        ui->console->append(QString("MD5=%0").arg(ret));
-        file.close();
-        return ret;
-    }
-    else {
-        ui->console->append("Could not open file to calculate MD5");
-    }
-    return QString();
-}
-
-
-
 void MainWindow::onDeleteButtonPressed()
 {
     TableWidgetData *currentWidget;
@@ -391,14 +386,11 @@ void MainWindow::onDeleteButtonPressed()
     if(currentWidget->table->selectedItems().count() < 1)
         return;
     int index = currentWidget->table->item(currentWidget->table->selectedItems().at(0)->row(), 0)->data(Qt::UserRole).toInt();
-    if(currentWidget->dataActionPerItem.value(index).action != TableWidgetData::ACTION_COPY_TO_SERVER) {//TODO CHECK
-        TableWidgetData::dataActionStruct temp;
-        temp.data = currentWidget->dataActionPerItem.value(index).data;
-        temp.action = TableWidgetData::ACTION_DELETE_FROM_SERVER;
-        currentWidget->dataActionPerItem.insert(index, temp);
+    if(currentWidget->item(index).action != TableWidgetData::ACTION_COPY_TO_SERVER) {//TODO CHECK
+        currentWidget->setAction(index, TableWidgetData::ACTION_DELETE_FROM_SERVER);
     }
     else {
-        currentWidget->dataActionPerItem.remove(currentWidget->table->item(currentWidget->table->selectedItems().at(0)->row(), 0)->data(Qt::UserRole).toInt());
+        currentWidget->remove(index);
     }
     fillTable(currentWidget);
 }
@@ -415,379 +407,296 @@ void MainWindow::onCancelNewItemButtonPressed()
 
 void MainWindow::onProcessNewItemButtonPressed()
 {
-    QString filename = QFileInfo(ui->packageLinkLE->text()).fileName();
-    QString completePath = workingRoot + filename;
-    completePath = completePath.remove(".exe").remove(".tar.xz").remove(".zip").remove(".tar.gz");
-    if(QDir(completePath).exists()) {
-        currentFilename = filename;
-        createNewItem(true);
+    pendingIngest = ingestRequestFromForm();
+    QString filename = QFileInfo(pendingIngest.packagePath).fileName();
+    if(QFile(pendingIngest.packagePath).exists()) {
         ui->console->append(QString("File %0 already present on temporary folder, skipping download").arg(filename));
+        createNewItem(true);
         return;
     }
-    ui->console->append(QString("Starting %0 download").arg(ui->packageLinkLE->text()));
-    QString text = ui->packageLinkLE->text();
-    currentFilename = text.right(text.size() - text.lastIndexOf("/"));
-    if(!settings->settings.infoUseFtp) {
-        processStatusChange(STATUS_PROCESSING_NEW_ITEM);
-        fileUtils->startFileDownload(QUrl(ui->packageLinkLE->text()));
-    }
-    else {
-        if(ftpLogin()) {
-            processStatusChange(STATUS_PROCESSING_NEW_ITEM);
-            int id = ftp->get(ui->packageLinkLE->text());
-            ftpOperations.insert(id, "downloading " + ui->packageLinkLE->text());
-            ftpDownloads.append(id);
-        }
-    }
+    QString text = pendingIngest.packageLink;
+    ui->console->append(QString("Starting %0 download").arg(text));
+    processStatusChange(STATUS_PROCESSING_NEW_ITEM);
+    downloadPackage(text).onFinished([this](const FtpFuture &result) {
+        if(result.isSuccess())
+            createNewItem(false, result.value().toByteArray());
+        else
+            createNewItem(false, QByteArray(), true, result.errorString());
+    });
 }
 
-void MainWindow::onWebFileDownloaded(bool result, QByteArray data, QString errorStr, QNetworkReply::NetworkError error)
+// Everything a job needs from the form and the settings, taken when the item
+// is submitted so the form can be reused while the job runs
+IngestJob::request MainWindow::ingestRequestFromForm()
 {
-    if(!result)
-        ui->console->append("File download failed with error:" + errorStr);
-    switch (currentStatus) {
-    case STATUS_FETCHING_INFO_FILE:
-        if(!result || (data.length() == 0)) {
-            if(error == QNetworkReply::ContentNotFoundError || data.length() == 0) {
-                    if(QMessageBox::question(this, "Information file apears not to exist on the server", "Do you want to create one?") == QMessageBox::Yes) {
-                        processStatusChange(STATUS_NEW_SYSTEM);
+    IngestJob::request request;
+    request.packageLink = ui->packageLinkLE->text();
+    request.osType = (xmlParser::osTypeEnum)ui->osCB->currentData().toInt();
+    request.type = (xmlParser::softTypeEnum)ui->typeCB->currentData().toInt();
+    request.hwType = ui->hwCB->currentData().toInt();
+    request.name = ui->nameLE->text();
+    request.date = ui->dateEdit->date();
+    request.uavHash = ui->uavoHashLE->text();
+    request.bundle = ui->allBoardsCB->isEnabled() && ui->allBoardsCB->isChecked();
+    completeIngestRequest(request);
+    return request;
+}
 
-                    }
-                    else
-                        processStatusChange(oldStatus);
-            }
-        }
-        else
-        {
-            ui->console->append("File download succeded");
-            if(processInformationFile(data)) {
-            }
-            else
-                processStatusChange(oldStatus);
-        }
-        break;
-    case STATUS_PROCESSING_NEW_ITEM:
-        if(result)
-            createNewItem(false, data);
+// Fills in what follows from the package link, the item kind and the settings
+void MainWindow::completeIngestRequest(IngestJob::request &request)
+{
+    request.packagePath = workingRoot + QFileInfo(request.packageLink).fileName();
+    request.osName = xmlParser::osTypeToString(request.osType);
+    request.typeName = xmlParser::softTypeToString(request.type);
+    request.hwName = xmlParser::hwTypeToStringHash.value(request.hwType);
+    request.serverPath = settings->settings.ftpPath;
+    request.rubyScriptPath = settings->settings.rubyScriptPath;
+    request.updaterScriptPath = settings->settings.updaterScriptPath.value(request.osType);
+    request.updaterBinaryPath = settings->settings.updaterBinaryPath.value(request.osType);
+}
+
+// Downloads a package from the FTP server or over HTTP, depending on the
+// settings; the value of the future is the package contents
+FtpFuture MainWindow::downloadPackage(QString link)
+{
+    if(settings->settings.infoUseFtp)
+        return ftpLogin().andThen([this, link]() { return asyncFtp->get(link); });
+    FtpPromise promise;
+    QNetworkReply *reply = packageNetwork->get(QNetworkRequest(QUrl(link)));
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
+    connect(reply, &QNetworkReply::finished, [reply, promise]() {
+        if(reply->error() == QNetworkReply::NoError)
+            promise.resolve(reply->readAll());
         else
-            createNewItem(false, data, true, errorStr);
-        break;
-    default:
-        Q_ASSERT(false);
-        break;
-    }
+            promise.reject(reply->errorString());
+        reply->deleteLater();
+    });
+    return promise.future();
 }
 
-bool MainWindow::createNewItem(bool alreadyDownloaded, QByteArray data, bool error, QString errorStr){
-    QString extractedPath;
-    QString gitHash;
-    QString completePath = workingRoot + currentFilename;
-    QString tempDir = workingRoot;
-    extractedPath = completePath;
-    extractedPath = extractedPath.remove(".exe").remove(".tar.xz").remove(".zip").remove(".tar.gz");
-    extractedPath += QDir::separator();
-    if(!QDir(tempDir).exists())
-        QDir().mkpath(tempDir);
-    bool result;
-    if(error) {
-        ui->console->append("File download failed with error:" + errorStr);
-        processStatusChange(STATUS_CREATING_ITEM);
-        return false;
+// Downloads the information file feeding every chunk to the reader as it
+// arrives; over HTTP the status code of a failed request is the reply code.
+// The value of the future is the server's tag of the file, as given by
+// informationFileTag(), so a fetch can be revalidated later.
+FtpFuture MainWindow::fetchInformationFile(QSharedPointer<CatalogReader> reader)
+{
+    QString link = informationFileLink();
+    if(settings->settings.infoUseFtp) {
+        return ftpLogin().andThen([this, link, reader]() {
+            return asyncFtp->get(link, [reader](const QByteArray &data) { reader->addData(data); });
+        }).andThen([this, link]() {
+            return ftpModificationTag(link);
+        });
     }
-    if(!alreadyDownloaded) {
-        ui->console->append("File download succeded");
-        ui->console->append("Starting package processing");
-        ui->console->append(QString("Saving downloaded file to %0").arg(workingRoot));
-        if(!saveDownloadedFile(data, workingRoot, currentFilename)) {
-            ui->console->append("Failed to save downloaded file");
-            processStatusChange(STATUS_CREATING_ITEM);
-            return false;
-        }
-        if(((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()!=xmlParser::SOFT_SETTINGS) && ((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()!=xmlParser::SOFT_UPDATER)) {
-            QStringList arguments;
-            arguments << "-xvf";
-            arguments << completePath;
-            arguments << "-C";
-            arguments << tempDir;
-            ui->console->append("Decompressing downloaded file");
-            process->start("tar", arguments);
-            eventLoop->exec();
-            if(process->exitStatus() == QProcess::NormalExit) {
-                if(process->exitCode() == 0) {
-                    ui->console->append("File decompressed to " + extractedPath);
-                }
-                else {
-                    ui->console->append(QString("Decompression FAILED with exit code %0").arg(process->exitCode()));
-                    processStatusChange(STATUS_CREATING_ITEM);
-                    return false;
-                }
-            }
-            else {
-                ui->console->append("Decompression FAILED");
-                processStatusChange(STATUS_CREATING_ITEM);
-                return false;
-            }
+    FtpPromise promise;
+    QNetworkReply *reply = packageNetwork->get(QNetworkRequest(QUrl(link)));
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
+    connect(reply, &QNetworkReply::readyRead, [reply, reader]() {
+        reader->addData(reply->readAll());
+    });
+    connect(reply, &QNetworkReply::finished, [reply, reader, promise]() {
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if(reply->error() == QNetworkReply::NoError) {
+            reader->addData(reply->readAll());
+            promise.resolve(httpModificationTag(reply), status);
         }
+        else
+            promise.reject(reply->errorString(), status);
+        reply->deleteLater();
+    });
+    return promise.future();
+}
+
+void MainWindow::onBatchItemsButtonPressed()
+{
+    if(ingestBatch) {
+        QMessageBox::warning(this, "Batch already running", "Wait for the current batch of items to finish and try again");
+        return;
     }
-    ui->console->append("Checking if downloaded file has the necessary files");
-    bool condition1 = false;
-    bool condition2 = false;
-    QString condition1_text;
-    QString condition2_text;
-    switch ((xmlParser::osTypeEnum)ui->osCB->currentData().toInt()) {
-    case xmlParser::OS_LINUX64:
-    case xmlParser::OS_LINUX32:
-        switch ((xmlParser::osTypeEnum)ui->typeCB->currentData().toInt()) {
-        case xmlParser::SOFT_SLIM_GCS:
-            condition1 = QDir(extractedPath + "slimgcs").exists();
-            condition1_text = "Directory slimgcs exists";
-            condition2 = QFileInfo(extractedPath + "tbsagent").isSymLink();//TODO
-            condition2_text = "Symlink to slimgcs binary exists";
-            break;
-        case xmlParser::SOFT_GCS:
-            condition1 = QDir(extractedPath + "gcs").exists();
-            condition1_text = "Directory gcs exists";
-            condition2 = QFileInfo(extractedPath + "taulabsgcs").isSymLink();
-            condition2_text = "Symlink to taulabsgcs binary exists";
-        case xmlParser::SOFT_UPDATER:
-            condition2 = QFile(completePath).exists();
-            condition2_text = completePath + "exists";
-            condition1 = true;
-            condition1_text = "";
-        default:
-            break;
-        }
-        break;
-    case xmlParser::OS_OSX64:
-    case xmlParser::OS_OSX32:
-        //TODO
-        break;
-    case xmlParser::OS_WIN64:
-    case xmlParser::OS_WIN32:
-        //TODO
-        break;
-    case xmlParser::OS_EMBEDED:
-        switch ((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()) {
-        case xmlParser::SOFT_FIRMWARE:
-            condition2 = QFile(extractedPath + "flight" + QDir::separator() + ui->hwCB->currentText().toLower() + QDir::separator() + QString("fw_%0.tlfw").arg(ui->hwCB->currentText().toLower())).exists();
-            condition2_text = extractedPath + "flight" + QString(QDir::separator()) + ui->hwCB->currentText().toLower() + QString(QDir::separator()) + QString("fw_%0.tlfw").arg(ui->hwCB->currentText().toLower()) + " exists on the extracted directory";
-            condition1 = true;
-            condition1_text = "";
-            qDebug() << "CHECKING " << condition2_text;
-            break;
-        case xmlParser::SOFT_BOOTLOADER:
-            condition2 = QFile(extractedPath + "flight" + QDir::separator() + ui->hwCB->currentText().toLower() + QDir::separator() + QString("bu_%0.tlfw").arg(ui->hwCB->currentText().toLower())).exists();
-            condition2_text = extractedPath + "flight" + QString(QDir::separator()) + ui->hwCB->currentText().toLower() + QString(QDir::separator()) + QString("bu_%0.tlfw").arg(ui->hwCB->currentText().toLower()) + " exists on the extracted directory";
-            condition1 = true;
-            condition1_text = "";
-            break;
-        case xmlParser::SOFT_SETTINGS:
-            condition1 = QFile(completePath).exists();
-            condition1_text = completePath + " exists";
-            condition2 = true;
-        default:
-            condition1 = true;
-            condition2 = true;
-            break;
+    bool ok = false;
+    QString text = QInputDialog::getMultiLineText(this, "Create items from a list", "One package per line as link;OS;type;hardware[;name]\nOS, type and hardware as shown on the item form, hardware none for software packages and all for every board of a firmware bundle", QString(), &ok);
+    if(!ok || text.trimmed().isEmpty())
+        return;
+    QStringList errors;
+    QList<IngestJob::request> requests = IngestBatch::parse(text, errors);
+    if(!errors.isEmpty()) {
+        foreach (QString error, errors) {
+            ui->console->append(error);
         }
-    default:
-        break;
+        QMessageBox::warning(this, "Invalid package list", errors.join("\n"));
+        return;
     }
-    if(!condition1_text.isEmpty()) {
-        if(condition1)
-            ui->console->append(QString("%0? = SUCCESS").arg(condition1_text));
-        else
-            ui->console->append(QString("%0? = FAILED").arg(condition1_text));
+    startIngestBatch(requests);
+}
+
+// Turns every artifact of a build server index page into items. Artifacts
+// already in the catalog, by name, link or package digest, are skipped.
+void MainWindow::onBuildServerButtonPressed()
+{
+    if(ingestBatch) {
+        QMessageBox::warning(this, "Batch already running", "Wait for the current batch of items to finish and try again");
+        return;
     }
-    if(!condition2_text.isEmpty()) {
-        if(condition2)
-            ui->console->append(QString("%0? = SUCCESS").arg(condition2_text));
-        else
-            ui->console->append(QString("%0? = FAILED").arg(condition2_text));
+    if(!buildIndexResult.isFinished()) {
+        QMessageBox::warning(this, "Build index still loading", "Wait for the current build index to load and try again");
+        return;
     }
-    if(!condition1 || !condition2) {
-        ui->console->append("FAILED to find required files, ABORTING!");
-        processStatusChange(STATUS_CREATING_ITEM);
-        return false;
+    bool ok = false;
+    QString url = QInputDialog::getText(this, "Create items from a build", "Build index page URL", QLineEdit::Normal, QString(), &ok);
+    if(!ok || url.trimmed().isEmpty())
+        return;
+    QSet<QString> knownNames;
+    QSet<QString> knownDigests;
+    foreach (TableWidgetData *table, QList<TableWidgetData*>() << releaseTable << testReleaseTable << oldReleaseTable) {
+        foreach (const TableWidgetData::dataActionStruct &item, table->items()) {
+            knownNames.insert(item.data.name);
+            knownNames.insert(item.data.packageLink.fileName());
+        }
+        knownDigests.unite(table->digests().toSet());
     }
-    //only if not updater binary or settings file
-    if(((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()!=xmlParser::SOFT_UPDATER) && ((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()!=xmlParser::SOFT_SETTINGS) ) {
-        ui->console->append("Processing INFO file");
-        QFile infoFile(extractedPath + "BUILD_INFO");
-        if(!infoFile.open(QIODevice::ReadOnly)) {
-            ui->console->append("FAILED to open INFO file");
-            processStatusChange(STATUS_CREATING_ITEM);
-            return false;
+    ui->console->append(QString("Fetching build index %0").arg(url));
+    buildIndexResult = fileUtils->fetchWebFiles(QUrl(url.trimmed()));
+    buildIndexResult.onFinished([this, knownNames, knownDigests](const FtpFuture &result) {
+        if(!result.isSuccess()) {
+            ui->console->append(QString("Could not fetch the build index:%0").arg(result.errorString()));
+            return;
         }
-        QTextStream in(&infoFile);
-        QString tagStr, valueStr;
-        while (!in.atEnd())
-        {
-            QString line = in.readLine();
-            QStringList l = line.split("=");
-            if(l.length() == 2)
-            {
-                if(l.at(0) == "BRANCH") {
-                }
-                else if(l.at(0) == "GIT_HASH") {
-                    gitHash = l.at(1);
-                    tagStr = "gitHash";
-                    valueStr = gitHash;
-                }
-                else if(l.at(0) == "DATE") {
-                    ui->dateEdit->setDate(QDate::fromString(l.at(1), "yyyyMMdd"));
-                    tagStr = "Date";
-                    valueStr = l.at(1);
-                }
-                else if(l.at(0) == "UAVO_HASH") {
-                    QString temp;
-                    temp = l.at(1);
-                    temp = temp.remove(",").remove("0x");
-                    ui->uavoHashLE->setText(temp);
-                    tagStr = "UAVO Hash";
-                    valueStr = temp;
-                }
-                ui->console->append(QString("Info file says %0=%1").arg(tagStr).arg(valueStr));
+        if(ingestBatch) {
+            ui->console->append("A batch of items started while the build index was loading, try again once it finishes");
+            return;
+        }
+        QList<IngestJob::request> requests;
+        foreach (webFileUtils::webFile file, result.value().value<QList<webFileUtils::webFile> >()) {
+            QString name = file.url.fileName();
+            if(knownNames.contains(name)) {
+                ui->console->append(QString("%0 already in the catalog, skipping").arg(name));
+                continue;
+            }
+            IngestJob::request request;
+            if(!IngestBatch::classify(name, request)) {
+                ui->console->append(QString("Could not tell what %0 is, skipping").arg(name));
+                continue;
             }
+            request.packageLink = file.url.toString();
+            ui->console->append(QString("%0 is %1 %2%3").arg(name).arg(xmlParser::osTypeToString(request.osType)).arg(xmlParser::softTypeToString(request.type)).arg(request.bundle ? " for all boards" : ""));
+            requests.append(request);
         }
-        ui->console->append("Done processing INFO file");
-        if((xmlParser::osTypeEnum)ui->osCB->currentData().toInt() != xmlParser::OS_EMBEDED) {
-            QString script = settings->settings.updaterScriptPath.value((xmlParser::osTypeEnum)ui->osCB->currentData().toInt());
-            QString updater = settings->settings.updaterBinaryPath.value((xmlParser::osTypeEnum)ui->osCB->currentData().toInt());
-            QString sourceDir;
-            QStringList arguments;
-            arguments.append("-u");
-            sourceDir = extractedPath;
-            process->setWorkingDirectory(tempDir);
-            ui->console->append(QString("Running ruby script with command:ruby %0 -p %1 -v 0 -u %2 %3 %4 ./currentbuild").arg(settings->settings.rubyScriptPath, ui->osCB->currentText().remove(" "), updater, sourceDir, script));
-            process->start(QString("ruby %0 -p %1 -v 0 -u %2 %3 %4 ./currentbuild").arg(settings->settings.rubyScriptPath, ui->osCB->currentText().remove(" "), updater, sourceDir, script));
-            eventLoop->exec();
+        if(requests.isEmpty()) {
+            ui->console->append("Nothing new to add from this build");
+            return;
         }
+        startIngestBatch(requests, knownDigests);
+    });
+}
+
+void MainWindow::startIngestBatch(QList<IngestJob::request> requests, QSet<QString> knownDigests)
+{
+    for(int x = 0; x < requests.count(); ++x) {
+        requests[x].date = QDate::currentDate();
+        completeIngestRequest(requests[x]);
     }
-    QString releasePartialPath;
-    releasePartialPath = ui->osCB->currentText() + QDir::separator();
-    if((xmlParser::osTypeEnum)ui->osCB->currentData().toInt() != xmlParser::OS_EMBEDED && (xmlParser::softTypeEnum)ui->typeCB->currentData().toInt() != xmlParser::SOFT_UPDATER) {
-        releasePartialPath += ui->typeCB->currentText();
-    }
-    else if ((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt() != xmlParser::SOFT_UPDATER){
-        releasePartialPath += ui->hwCB->currentText().toLower();
-    }
-    releasePartialPath = releasePartialPath.remove(" ");
-    QString releaseStoragePath = workingRoot + "releases" + QDir::separator();
-    QDir().mkpath(releaseStoragePath);
-    QString serverStoragePath = settings->settings.ftpPath + releasePartialPath + QDir::separator();
-    serverStoragePath = serverStoragePath.replace(QString("%0%1").arg(QDir::separator()).arg(QDir::separator()), QDir::separator());
-    ui->console->append(QString("Setting %0 to %1").arg("releasePartialPath").arg(releasePartialPath));
-    ui->console->append(QString("Setting %0 to %1").arg("releaseStoragePath").arg(releaseStoragePath));
-    ui->console->append(QString("Setting %0 to %1").arg("serverStoragePath").arg(serverStoragePath));
-
-    QString file;
-    QString source, destination;
-    bool partialResult = false;
-    switch ((xmlParser::softTypeEnum)ui->typeCB->currentData().toInt()) {
-    case xmlParser::SOFT_BOOTLOADER:
-        file = QString("bu_%0_%1.tlfw").arg(ui->dateEdit->date().toString("yyyyMMdd")).arg(gitHash);
-        ui->releaseLinkE->setText(serverStoragePath + file);
-        source = QString(extractedPath + "flight" + QDir::separator() + ui->hwCB->currentText().toLower() + QDir::separator() + "bu_%0.tlfw").arg(ui->hwCB->currentText().toLower());
-        destination = releaseStoragePath + file;
-        result = QFile::copy(source, destination);
-        ui->md5LE->setText(calculateMD5(destination));
-        ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(result));
-        break;
-    case xmlParser::SOFT_FIRMWARE:
-        file = QString("fw_%0_%1.tlfw").arg(ui->dateEdit->date().toString("yyyyMMdd")).arg(gitHash);
-        ui->releaseLinkE->setText(serverStoragePath + file);
-        source = QString(extractedPath + "flight" + QDir::separator() + ui->hwCB->currentText().toLower() + QDir::separator() + "fw_%0.tlfw").arg(ui->hwCB->currentText().toLower());
-        destination = releaseStoragePath + file;
-        result = QFile::copy(source, destination);
-        ui->md5LE->setText(calculateMD5(destination));
-        ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(result));
-        break;
-    case xmlParser::SOFT_SETTINGS:
-        file = QString( "settings_%0_%1.xml").arg(ui->dateEdit->date().toString("yyyyMMdd")).arg(gitHash);
-        ui->releaseLinkE->setText(serverStoragePath + file);
-        source = completePath;
-        destination = releaseStoragePath + file;
-        result = QFile::copy(source, destination);
-        ui->md5LE->setText(calculateMD5(destination));
-        ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(result));
-        break;
-    case xmlParser::SOFT_GCS:
-    case xmlParser::SOFT_SLIM_GCS:
-        file = QString("%0_%1.zip").arg(ui->dateEdit->date().toString("yyyyMMdd")).arg(gitHash);
-        ui->releaseLinkE->setText(serverStoragePath + file);
-        source = QString(workingRoot + "currentbuild" + QDir::separator() + "app.zip");
-        destination = releaseStoragePath + file;
-        result = QFile::copy(source, destination);
-        ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(result));
-        ui->md5LE->setText(calculateMD5(destination));
-        file = QString("%0_%1.xml").arg(ui->dateEdit->date().toString("yyyyMMdd")).arg(gitHash);
-        ui->scritLinkLE->setText(serverStoragePath + file);
-        source = QString(workingRoot + "currentbuild" + QDir::separator() + "file_list.xml");
-        destination = releaseStoragePath + file;
-        partialResult = QFile::copy(source, destination);
-        ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(partialResult));
-        result &= partialResult;
-        break;
-    case xmlParser::SOFT_UPDATER:
-        switch ((xmlParser::osTypeEnum)ui->osCB->currentData().toInt()) {
-        case xmlParser::OS_LINUX32:
-        case xmlParser::OS_LINUX64:
-            file = QString("updater");
-            ui->releaseLinkE->setText(serverStoragePath + file);
-            source = completePath;
-            destination = releaseStoragePath + file;
-            result = QFile::copy(source, destination);
-            ui->md5LE->setText(calculateMD5(destination));
-            ui->console->append(QString("Copying %0 to %1 RESULT=%3").arg(source).arg(destination).arg(partialResult));
-            break;
-            //TODO
-        default:
-            Q_ASSERT(false);
-            break;
+    ui->console->append(QString("Starting batch of %0 items").arg(requests.count()));
+    ingestBatch = new IngestBatch(ingestEngine, [this](QString link) { return downloadPackage(link); }, this);
+    ingestBatch->setKnownDigests(knownDigests);
+    connect(ingestBatch, SIGNAL(logMessage(QString)), ui->console, SLOT(append(QString)));
+    connect(ingestBatch, SIGNAL(finished()), this, SLOT(onIngestBatchFinished()));
+    ingestBatch->start(requests);
+}
+
+// The items of a batch are only added once all of them are processed, in the
+// order they were listed
+void MainWindow::onIngestBatchFinished()
+{
+    int added = 0;
+    foreach (IngestBatch::entry entry, ingestBatch->entries()) {
+        if(entry.success) {
+            foreach (IngestJob::output output, entry.outputs) {
+                if(addIngestedItem(output.item, output.releaseDir))
+                    ++added;
+            }
         }
-        break;
-    default:
-        Q_ASSERT(false);
-        break;
+        if(!entry.stagingDir.isEmpty())
+            QDir(entry.stagingDir).removeRecursively();
     }
-    if(result)
-    {
-        ui->console->append("Release packages copied to local temp directory");
-        xmlParser::softData newItem;
-        newItem.date = ui->dateEdit->date();
-        newItem.hwType = ui->hwCB->currentData().toInt();
-        newItem.md5 = ui->md5LE->text();
-        newItem.name = ui->nameLE->text();
-        newItem.osType = (xmlParser::osTypeEnum) ui->osCB->currentData().toInt();
-        newItem.packageLink = ui->packageLinkLE->text();
-        newItem.releaseLink = ui->releaseLinkE->text();
-        newItem.scriptLink = ui->scritLinkLE->text();
-        newItem.type = (xmlParser::softTypeEnum) ui->typeCB->currentData().toInt();
-        newItem.uavHash = ui->uavoHashLE->text();
-        QString original = workingRoot + "releases";
-        QDir dir;
-        int newItemIndex = addNewItem(newItem);
-        QString dest = workingRoot + "release" + QString::number(newItemIndex);
-        ui->console->append(QString("Moving temporary directory %0 to %1").arg(original, dest));
-        if(QDir(dest).exists())
-            QDir(dest).removeRecursively();
-        if( !dir.rename( original, dest ) ){
-            ui->console->append("Moving failed, Aborting");
-            processStatusChange(oldStatus);
-            return false;
-        }
-        else {
-            ui->console->append("Adding new item DONE");
-            return true;
-        }
+    ui->console->append(QString("Batch finished, %0 items from %1 packages added to the test releases").arg(added).arg(ingestBatch->count()));
+    ui->statusBar->clearMessage();
+    ingestBatch->deleteLater();
+    ingestBatch = NULL;
+}
+
+bool MainWindow::createNewItem(bool alreadyDownloaded, QByteArray data, bool error, QString errorStr){
+    if(error) {
+        ui->console->append("File download failed with error:" + errorStr);
+        processStatusChange(STATUS_CREATING_ITEM);
+        return false;
     }
+    IngestJob::request request = pendingIngest;
+    pendingIngest = IngestJob::request();
+    if(!alreadyDownloaded) {
+        ui->console->append("File download succeded");
+        request.packageData = data;
+    }
+    int id = ingestEngine->submit(request);
+    qCDebug(lcIngest) << "Job" << id << "for" << request.packageLink << request.packageData.size() << "bytes";
+    ui->console->append(QString("Starting package processing as job %0").arg(id));
+    processStatusChange(oldStatus);
+    return true;
+}
+
+void MainWindow::onIngestStageChanged(int id, int stage)
+{
+    IngestJob *job = ingestEngine->job(id);
+    if(job)
+        ui->statusBar->showMessage(QString("%0: %1").arg(job->name()).arg(IngestJob::stageToString((IngestJob::stageEnum)stage)));
+}
+
+void MainWindow::onIngestProgress(int id, qint64 done, qint64 total)
+{
+    IngestJob *job = ingestEngine->job(id);
+    if(job && total > 0)
+        ui->statusBar->showMessage(QString("%0: %1%").arg(job->name()).arg((done * 100) / total));
+}
+
+void MainWindow::onIngestLogMessage(int id, QString text)
+{
+    IngestJob *job = ingestEngine->job(id);
+    ui->console->append(QString("[%0] %1").arg(job ? job->name() : QString::number(id)).arg(text));
+}
+
+void MainWindow::onIngestJobFinished(int id, bool success)
+{
+    // jobs of a batch are collected by the batch itself
+    if(ingestBatch && ingestBatch->contains(id))
+        return;
+    IngestJob *job = ingestEngine->takeJob(id);
+    if(!job)
+        return;
+    if(!success)
+        ui->console->append(QString("[%0] Adding new item FAILED").arg(job->name()));
     else {
-        ui->console->append("Release packages copy FAILED");
-        return false;
+        foreach (IngestJob::output output, job->outputs()) {
+            addIngestedItem(output.item, output.releaseDir);
+        }
     }
+    ui->statusBar->clearMessage();
+    QDir(job->stagingDir()).removeRecursively();
+    job->deleteLater();
 }
 
+bool MainWindow::addIngestedItem(xmlParser::softData item, QString releaseDir)
+{
+    int newItemIndex = addNewItem(item);
+    QString dest = workingRoot + "release" + QString::number(newItemIndex);
+    ui->console->append(QString("Moving temporary directory %0 to %1").arg(releaseDir, dest));
+    if(QDir(dest).exists())
+        QDir(dest).removeRecursively();
+    if(!QDir().rename(releaseDir, dest)) {
+        ui->console->append("Moving failed, Aborting");
+        return false;
+    }
+    ui->console->append("Adding new item DONE");
+    return true;
+}
 
 void MainWindow::onDownloadProgress(qint64 current, qint64 total)
 {
@@ -804,13 +713,6 @@ void MainWindow::onDownloadProgress(qint64 current, qint64 total)
         ui->console->append(QString("Download file progress:%0%").arg((current * 100) / total));
 }
 
-void MainWindow::onReadyReadFromProcess()
-{
-    QByteArray array = process->readAll();
-    if(!array.isEmpty())
-        ui->console->append(array);
-}
-
 void MainWindow::onSettingsButtonPressed()
 {
     settings->show();
@@ -844,64 +746,12 @@ void MainWindow::onFtpStateChanged(int state)
     ui->console->append(QString("FTP state changed to:%0").arg(text));
 }
 
-void MainWindow::onFtpOperationEnded(int opID, bool error)
+void MainWindow::onFtpOperationFinished(QString description, bool error, QString errorString)
 {
-    if(ftpOperations.keys().contains(opID)) {
-        if(!error)
-            ui->console->append(QString("FTP %0 operation was successfull").arg(ftpOperations.value(opID)));
-        else
-            ui->console->append(QString("FTP %0 operation was unsuccessfull. Error:%1").arg(ftpOperations.value(opID)).arg(ftp->errorString()));
-    }
-    else {
-        if(error)
-            ui->console->append(QString("FTP operation was unsuccessfull. Error:%0").arg(ftp->errorString()));
-        else
-            ui->console->append("FTP operation was successfull");
-    }
-    if(ftpDirsCheckOperations.contains(opID)) {
-        ftpDirsCheckOperations.removeAll(opID);
-        lastFtpOperationSuccess = !error;
-        ftpDirCheckEventLoop.quit();
-    }
-    if(ftpMkDirOperations.contains(opID)) {
-        ftpMkDirOperations.removeAll(opID);
-        lastFtpOperationSuccess = !error;
-        ftpDirCheckEventLoop.quit();
-    }
-    if(ftpDownloads.contains(opID)) {
-        ftpDownloads.removeAll(opID);
-        switch (currentStatus) {
-        case STATUS_FETCHING_INFO_FILE:
-            if(!error) {
-                processStatusChange(STATUS_PARSING_INFO_FILE);
-                if(processInformationFile(ftp->readAll())){
-                }
-                else {
-                    processStatusChange(oldStatus);
-                }
-            }
-            else {
-                    if(QMessageBox::question(this, "Information file apears not to exist on the server", "Do you want to create one?") == QMessageBox::Yes) {
-                        processStatusChange(STATUS_NEW_SYSTEM);
-                    }
-                    else
-                        processStatusChange(oldStatus);
-            }
-            break;
-        case STATUS_PROCESSING_NEW_ITEM:
-            if(error) {
-                createNewItem(false, QByteArray(), true, ftp->errorString());
-            }
-            else {
-                createNewItem(false, ftp->readAll());
-            }
-            break;
-        default:
-            Q_ASSERT(false);
-            break;
-        }
-    }
-
+    if(!error)
+        ui->console->append(QString("FTP %0 operation was successfull").arg(description));
+    else
+        ui->console->append(QString("FTP %0 operation was unsuccessfull. Error:%1").arg(description).arg(errorString));
 }
 
 void MainWindow::onFtpTransferProgress(qint64 current, qint64 total)
@@ -909,28 +759,170 @@ void MainWindow::onFtpTransferProgress(qint64 current, qint64 total)
     onDownloadProgress(current, total);
 }
 
-bool MainWindow::processInformationFile(QByteArray array)
+// Shows the catalog of a reader that was fed the whole information file and
+// keeps it as the local copy for the next session
+bool MainWindow::showInformationFile(CatalogReader &reader, QString remoteTag)
 {
-    bool success = false;
-    QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> dataset = parser->parseXML(QString(array), success);
-    if(!success) {
+    if(!reader.finish()) {
+        ui->console->append(QString("Error(%0) parsing xml on line %1 column %2").arg(reader.errorString()).arg(reader.lineNumber()).arg(reader.columnNumber()));
         ui->console->append("XML information file parsing FAILED");
         return false;
     }
+    showingSnapshot = false;
+    showCatalog(reader.catalog());
+    catalogSnapshot.source = informationFileSource();
+    catalogSnapshot.sourceMD5 = reader.sourceMD5();
+    catalogSnapshot.remoteTag = remoteTag;
+    if(!reader.catalog().saveSnapshot(catalogSnapshotFile(), catalogSnapshot))
+        ui->console->append("Could not save the local copy of the information file");
+    return true;
+}
+
+void MainWindow::showCatalog(const SoftCatalog &catalog)
+{
     if(releaseTable)
         delete releaseTable;
     if(oldReleaseTable)
         delete oldReleaseTable;
     if(testReleaseTable)
         delete testReleaseTable;
-    releaseTable = new TableWidgetData(this, ui->featuredReleasesTable, dataset.values(xmlParser::RELEASE_CURRENT));
-    oldReleaseTable = new TableWidgetData(this, ui->oldReleasesTable, dataset.values(xmlParser::RELEASE_OLD));
-    testReleaseTable = new TableWidgetData(this, ui->testReleasesTable, dataset.values(xmlParser::RELEASE_TEST));
+    releaseTable = new TableWidgetData(this, ui->featuredReleasesTable, catalog.items(xmlParser::RELEASE_CURRENT));
+    oldReleaseTable = new TableWidgetData(this, ui->oldReleasesTable, catalog.items(xmlParser::RELEASE_OLD));
+    testReleaseTable = new TableWidgetData(this, ui->testReleasesTable, catalog.items(xmlParser::RELEASE_TEST));
     this->fillTable(releaseTable);
     this->fillTable(oldReleaseTable);
     this->fillTable(testReleaseTable);
     processStatusChange(STATUS_EDITING_RELEASE);
-    return true;
+}
+
+QString MainWindow::informationFileLink() const
+{
+    if(settings->settings.infoUseFtp || settings->settings.infoPath.endsWith("/"))
+        return settings->settings.infoPath + settings->settings.infoReleaseFilename;
+    return settings->settings.infoPath + "/" + settings->settings.infoReleaseFilename;
+}
+
+// Tells snapshots of different servers apart
+QString MainWindow::informationFileSource() const
+{
+    if(settings->settings.infoUseFtp)
+        return QString("ftp://%0@%1/%2").arg(settings->settings.ftpUserName).arg(settings->settings.ftpServerUrl).arg(informationFileLink());
+    return informationFileLink();
+}
+
+QString MainWindow::catalogSnapshotFile() const
+{
+    return QApplication::applicationDirPath() + QDir::separator() + "catalog.snapshot";
+}
+
+// Shows the catalog of the last session right away, then checks in the
+// background whether the information file changed on the server since.
+// Pushing stays disabled until that check confirms the local copy.
+void MainWindow::loadCatalogSnapshot()
+{
+    SoftCatalog catalog;
+    QElapsedTimer timer;
+    timer.start();
+    if(!catalog.loadSnapshot(catalogSnapshotFile(), catalogSnapshot))
+        return;
+    if(catalogSnapshot.source != informationFileSource())
+        return;
+    showingSnapshot = true;
+    showCatalog(catalog);
+    ui->console->append(QString("Loaded %0 items from the local copy of the information file in %1ms").arg(catalog.count()).arg(timer.elapsed()));
+    if(settings->settings.infoUseFtp && (settings->settings.ftpUserName.isEmpty() || settings->settings.ftpPassword.isEmpty())) {
+        ui->console->append("No stored FTP credentials, fetch the information file to check it is up to date");
+        return;
+    }
+    revalidateCatalogSnapshot();
+}
+
+void MainWindow::revalidateCatalogSnapshot()
+{
+    informationFileTag().onFinished([this](const FtpFuture &tag) {
+        QString remoteTag = tag.value().toString();
+        if(!remoteTag.isEmpty() && remoteTag == catalogSnapshot.remoteTag) {
+            ui->console->append("The local copy of the information file is up to date");
+            confirmCatalogSnapshot();
+            return;
+        }
+        QSharedPointer<CatalogReader> reader(new CatalogReader);
+        fetchInformationFile(reader).onFinished([this, remoteTag, reader](const FtpFuture &result) {
+            if(!result.isSuccess()) {
+                ui->console->append(QString("Could not check the information file on the server:%0").arg(result.errorString()));
+                return;
+            }
+            if(reader->sourceMD5() == catalogSnapshot.sourceMD5) {
+                //same contents, only remember the new tag
+                catalogSnapshot.remoteTag = remoteTag;
+                if(reader->finish())
+                    reader->catalog().saveSnapshot(catalogSnapshotFile(), catalogSnapshot);
+                ui->console->append("The local copy of the information file is up to date");
+                confirmCatalogSnapshot();
+            }
+            else if(showingSnapshot && !hasPendingChanges() && currentStatus == STATUS_EDITING_RELEASE) {
+                ui->console->append("The information file changed on the server, reloading it");
+                showInformationFile(*reader, remoteTag);
+            }
+            else
+                ui->console->append("The information file changed on the server, fetch it again before pushing");
+        });
+    });
+}
+
+void MainWindow::confirmCatalogSnapshot()
+{
+    showingSnapshot = false;
+    if(currentStatus == STATUS_EDITING_RELEASE)
+        ui->pushTB->setEnabled(true);
+}
+
+// The server's modification tag of the information file, MDTM over FTP and
+// ETag or Last-Modified over HTTP; empty if the server gives none
+FtpFuture MainWindow::informationFileTag()
+{
+    if(settings->settings.infoUseFtp) {
+        QString file = informationFileLink();
+        return ftpLogin().andThen([this, file]() {
+            return ftpModificationTag(file);
+        });
+    }
+    FtpPromise promise;
+    QNetworkReply *reply = packageNetwork->head(QNetworkRequest(QUrl(informationFileLink())));
+    connect(reply, &QNetworkReply::finished, [reply, promise]() {
+        promise.resolve(reply->error() == QNetworkReply::NoError ? httpModificationTag(reply) : QString());
+        reply->deleteLater();
+    });
+    return promise.future();
+}
+
+// Always succeeds, with an empty tag if the server doesn't support MDTM
+FtpFuture MainWindow::ftpModificationTag(QString file)
+{
+    return asyncFtp->rawCommand("MDTM " + file).then([](const FtpFuture &reply) {
+        if(!reply.isSuccess() || reply.replyCode() != 213)
+            return FtpFuture::succeeded(QString());
+        return FtpFuture::succeeded(reply.replyText().trimmed());
+    });
+}
+
+QString MainWindow::httpModificationTag(QNetworkReply *reply)
+{
+    QString tag = QString(reply->rawHeader("ETag"));
+    if(tag.isEmpty())
+        tag = QString(reply->rawHeader("Last-Modified"));
+    return tag;
+}
+
+bool MainWindow::hasPendingChanges() const
+{
+    foreach (TableWidgetData *table, QList<TableWidgetData*>() << releaseTable << testReleaseTable << oldReleaseTable) {
+        foreach (TableWidgetData::dataActionStruct item, table->items().values()) {
+            if(item.action != TableWidgetData::ACTION_NONE)
+                return true;
+        }
+    }
+    return false;
 }
 
 void MainWindow::onComboboxesCurrentChanged(int index)
@@ -940,6 +932,7 @@ void MainWindow::onComboboxesCurrentChanged(int index)
     if(!box)
         return;
     if(box == ui->typeCB) {
+        ui->allBoardsCB->setEnabled((ui->typeCB->currentData().toInt() == xmlParser::SOFT_FIRMWARE) || (ui->typeCB->currentData().toInt() == xmlParser::SOFT_BOOTLOADER));
         if((ui->typeCB->currentData().toInt() == xmlParser::SOFT_FIRMWARE) || (ui->typeCB->currentData().toInt() == xmlParser::SOFT_BOOTLOADER)
                 || (ui->typeCB->currentData().toInt() == xmlParser::SOFT_SETTINGS)) {
             ui->osCB->setCurrentIndex(ui->osCB->findData(xmlParser::OS_EMBEDED));
@@ -997,34 +990,158 @@ void MainWindow::onXMLParserMessage(QString text)
     ui->console->append(QString("XMLParser:%0").arg(text));
 }
 
-void MainWindow::onftpListInfo(QUrlInfo info)
+TableWidgetData::TableWidgetData(QObject *parent, QTableWidget *table, QList<xmlParser::softData> data):QObject(parent), table(table), endIndex(0), nextSequence(0)
 {
-    ftpLastListing.append(info);
+    for(int x = 0; x < data.length(); ++x) {
+        TableWidgetData::dataActionStruct temp;
+        temp.data = data.at(x);
+        temp.action = TableWidgetData::ACTION_NONE;
+        insert(temp);
+    }
+    connect(table, SIGNAL(currentCellChanged(int,int,int,int)), this, SLOT(onCurrentCellChanged(int,int,int,int)));
 }
 
-bool MainWindow::saveDownloadedFile(QByteArray data, QString path, QString fileName)
+const QHash<int, TableWidgetData::dataActionStruct> &TableWidgetData::items() const
 {
-    if(!QDir(path).exists())
-        QDir().mkpath(path);
-    if(!path.endsWith(QDir::separator()))
-        path.append(QDir::separator());
-    QFile localFile(path + fileName);
-    if (!localFile.open(QIODevice::WriteOnly))
-        return false;
-    localFile.write(data);
-    localFile.close();
-    return true;
+    return dataActionPerItem;
 }
 
-TableWidgetData::TableWidgetData(QObject *parent, QTableWidget *table, QList<xmlParser::softData> data):QObject(parent), table(table)
+// index must be in use
+const TableWidgetData::dataActionStruct &TableWidgetData::item(int index) const
 {
-    for(int x = 0; x < data.length(); ++x) {
-        TableWidgetData::dataActionStruct temp;
-        temp.data = data.at(x);
-        temp.action = TableWidgetData::ACTION_NONE;
-        dataActionPerItem.insert(x, temp);
+    return dataActionPerItem.find(index).value();
+}
+
+// Adds the item at the lowest unused index and returns that index
+int TableWidgetData::insert(const dataActionStruct &item)
+{
+    int index = freeIndex();
+    if(freeIndexes.empty())
+        ++endIndex;
+    else
+        freeIndexes.erase(freeIndexes.begin());
+    dataActionPerItem.insert(index, item);
+    addToIndex(index, item.data);
+    return index;
+}
+
+// Replaces the item at an index already in use
+void TableWidgetData::replace(int index, const dataActionStruct &item)
+{
+    QHash<int, dataActionStruct>::iterator it = dataActionPerItem.find(index);
+    Q_ASSERT(it != dataActionPerItem.end());
+    removeFromIndex(index, it.value().data);
+    it.value() = item;
+    addToIndex(index, item.data);
+}
+
+// The indexes don't look at the action, so it changes in place
+void TableWidgetData::setAction(int index, action newAction)
+{
+    QHash<int, dataActionStruct>::iterator it = dataActionPerItem.find(index);
+    if(it != dataActionPerItem.end())
+        it.value().action = newAction;
+}
+
+void TableWidgetData::remove(int index)
+{
+    QHash<int, dataActionStruct>::iterator it = dataActionPerItem.find(index);
+    if(it == dataActionPerItem.end())
+        return;
+    removeFromIndex(index, it.value().data);
+    dataActionPerItem.erase(it);
+    freeIndexes.insert(index);
+}
+
+void TableWidgetData::clear()
+{
+    dataActionPerItem.clear();
+    byTarget.clear();
+    orderOfIndex.clear();
+    byMD5.clear();
+    freeIndexes.clear();
+    endIndex = 0;
+}
+
+int TableWidgetData::freeIndex() const
+{
+    return freeIndexes.empty() ? endIndex : *freeIndexes.begin();
+}
+
+QList<int> TableWidgetData::withTarget(target key) const
+{
+    return byTarget.value(key).values();
+}
+
+QList<int> TableWidgetData::withMD5(QString md5) const
+{
+    return byMD5.value(md5).toList();
+}
+
+// The newest item for the target, -1 if there is none
+int TableWidgetData::latest(target key) const
+{
+    QHash<target, QMap<order, int> >::const_iterator sameTarget = byTarget.find(key);
+    if(sameTarget == byTarget.end())
+        return -1;
+    return sameTarget.value().last();
+}
+
+QList<QString> TableWidgetData::digests() const
+{
+    return byMD5.keys();
+}
+
+TableWidgetData::target TableWidgetData::targetOf(xmlParser::softTypeEnum type, xmlParser::osTypeEnum osType, quint16 hwType)
+{
+    bool embeded = (type == xmlParser::SOFT_FIRMWARE) || (type == xmlParser::SOFT_BOOTLOADER) || (type == xmlParser::SOFT_SETTINGS);
+    if(embeded)
+        return (target(type) << 24) | 0x10000 | hwType;
+    return (target(type) << 24) | osType;
+}
+
+TableWidgetData::target TableWidgetData::targetOf(const xmlParser::softData &data)
+{
+    return targetOf(data.type, data.osType, data.hwType);
+}
+
+bool TableWidgetData::order::operator<(const TableWidgetData::order &other) const
+{
+    if(date != other.date)
+        return date < other.date;
+    if(name != other.name)
+        return name < other.name;
+    if(md5 != other.md5)
+        return md5 < other.md5;
+    return sequence < other.sequence;
+}
+
+void TableWidgetData::addToIndex(int index, const xmlParser::softData &data)
+{
+    order key;
+    key.date = data.date;
+    key.name = data.name;
+    key.md5 = data.md5;
+    key.sequence = nextSequence++;
+    orderOfIndex.insert(index, key);
+    byTarget[targetOf(data)].insert(key, index);
+    byMD5[data.md5].insert(index);
+}
+
+void TableWidgetData::removeFromIndex(int index, const xmlParser::softData &data)
+{
+    QHash<target, QMap<order, int> >::iterator sameTarget = byTarget.find(targetOf(data));
+    if(sameTarget != byTarget.end()) {
+        sameTarget.value().remove(orderOfIndex.take(index));
+        if(sameTarget.value().isEmpty())
+            byTarget.erase(sameTarget);
+    }
+    QHash<QString, QSet<int> >::iterator sameMD5 = byMD5.find(data.md5);
+    if(sameMD5 != byMD5.end()) {
+        sameMD5.value().remove(index);
+        if(sameMD5.value().isEmpty())
+            byMD5.erase(sameMD5);
     }
-    connect(table, SIGNAL(currentCellChanged(int,int,int,int)), this, SLOT(onCurrentCellChanged(int,int,int,int)));
 }
 
 void TableWidgetData::onCurrentCellChanged(int x, int y, int xx, int yy)
@@ -1036,30 +1153,40 @@ void TableWidgetData::onCurrentCellChanged(int x, int y, int xx, int yy)
 }
 void MainWindow::onPushButtonPressed()
 {
+    if(ingestBatch) {
+        QMessageBox::warning(this, "Can't push", "A batch of items is still being processed, wait for it to finish and try again");
+        return;
+    }
+    if(showingSnapshot) {
+        QMessageBox::warning(this, "Can't push", "The local copy of the information file was not confirmed by the server yet, fetch the information file and try again");
+        return;
+    }
     QStringList filesToPush;
     QHash<QString, QString> localFiles;
+    QHash<QString, QString> recordedMD5;
     QStringList filesToDelete;
     QList<TableWidgetData* > workingTablesList;
     workingTablesList << testReleaseTable << oldReleaseTable << releaseTable;
     QString filename;
     foreach(TableWidgetData * workingTable, workingTablesList)
     {
-        foreach (int i, workingTable->dataActionPerItem.keys()) {
-            switch (workingTable->dataActionPerItem.value(i).action) {
+        foreach (int i, workingTable->items().keys()) {
+            switch (workingTable->item(i).action) {
             case TableWidgetData::ACTION_DELETE_FROM_SERVER:
-                filesToDelete.append(workingTable->dataActionPerItem.value(i).data.releaseLink.toString());
-                if(!workingTable->dataActionPerItem.value(i).data.scriptLink.isEmpty()) {
-                    filesToDelete.append(workingTable->dataActionPerItem.value(i).data.scriptLink.toString());
+                filesToDelete.append(workingTable->item(i).data.releaseLink.toString());
+                if(!workingTable->item(i).data.scriptLink.isEmpty()) {
+                    filesToDelete.append(workingTable->item(i).data.scriptLink.toString());
                 }
                 break;
             case TableWidgetData::ACTION_COPY_TO_SERVER:
-                filesToPush.append(workingTable->dataActionPerItem.value(i).data.releaseLink.toString());
-                filename = QFileInfo(workingTable->dataActionPerItem.value(i).data.releaseLink.toString()).fileName();
-                localFiles.insert(workingTable->dataActionPerItem.value(i).data.releaseLink.toString(), QDir::temp().absolutePath() + QDir::separator() + "release_builder" + QDir::separator() + "release" + QString::number(i) + QDir::separator() + filename);
-                if(!workingTable->dataActionPerItem.value(i).data.scriptLink.isEmpty()) {
-                    filesToPush.append(workingTable->dataActionPerItem.value(i).data.scriptLink.toString());
-                    filename = QFileInfo(workingTable->dataActionPerItem.value(i).data.scriptLink.toString()).fileName();
-                    localFiles.insert(workingTable->dataActionPerItem.value(i).data.scriptLink.toString(), QDir::temp().absolutePath() + QDir::separator() + "release_builder" + QDir::separator() + "release" + QString::number(i) + QDir::separator() + filename);
+                filesToPush.append(workingTable->item(i).data.releaseLink.toString());
+                filename = QFileInfo(workingTable->item(i).data.releaseLink.toString()).fileName();
+                localFiles.insert(workingTable->item(i).data.releaseLink.toString(), QDir::temp().absolutePath() + QDir::separator() + "release_builder" + QDir::separator() + "release" + QString::number(i) + QDir::separator() + filename);
+                recordedMD5.insert(workingTable->item(i).data.releaseLink.toString(), workingTable->item(i).data.md5);
+                if(!workingTable->item(i).data.scriptLink.isEmpty()) {
+                    filesToPush.append(workingTable->item(i).data.scriptLink.toString());
+                    filename = QFileInfo(workingTable->item(i).data.scriptLink.toString()).fileName();
+                    localFiles.insert(workingTable->item(i).data.scriptLink.toString(), QDir::temp().absolutePath() + QDir::separator() + "release_builder" + QDir::separator() + "release" + QString::number(i) + QDir::separator() + filename);
                 }
                 break;
             default:
@@ -1067,72 +1194,224 @@ void MainWindow::onPushButtonPressed()
             }
         }
     }
-    QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> dataList;
-    foreach (TableWidgetData::dataActionStruct data, releaseTable->dataActionPerItem.values()) {
-        dataList.insert(xmlParser::RELEASE_CURRENT, data.data);
+    SoftCatalog catalog;
+    foreach (TableWidgetData::dataActionStruct data, releaseTable->items().values()) {
+        catalog.insert(xmlParser::RELEASE_CURRENT, data.data);
     }
-    foreach (TableWidgetData::dataActionStruct data, oldReleaseTable->dataActionPerItem.values()) {
-        dataList.insert(xmlParser::RELEASE_OLD, data.data);
+    foreach (TableWidgetData::dataActionStruct data, oldReleaseTable->items().values()) {
+        catalog.insert(xmlParser::RELEASE_OLD, data.data);
     }
-    foreach (TableWidgetData::dataActionStruct data, testReleaseTable->dataActionPerItem.values()) {
-        dataList.insert(xmlParser::RELEASE_TEST, data.data);
+    foreach (TableWidgetData::dataActionStruct data, testReleaseTable->items().values()) {
+        catalog.insert(xmlParser::RELEASE_TEST, data.data);
     }
-    QString xml = parser->convertSoftDataToXMLString(dataList);
-    if(!filesToDelete.isEmpty()) {
-        ui->console->append("GOING TO DELETE FILES:");
-        foreach (QString file, filesToDelete) {
-            ui->console->append(file);
-        }
+    QByteArray xml;
+    QBuffer xmlBuffer(&xml);
+    xmlBuffer.open(QIODevice::WriteOnly);
+    parser->writeXML(catalog, &xmlBuffer);
+    xmlBuffer.close();
+    pushPlanner->clear();
+    foreach (QString file, filesToPush) {
+        pushPlanner->addUpload(file, localFiles.value(file), recordedMD5.value(file));
     }
-    if(!filesToPush.isEmpty()) {
-        ui->console->append("GOING TO PUSH FILES:");
-        foreach (QString file, filesToPush) {
-            ui->console->append(file);
-        }
+    foreach (QString file, filesToDelete) {
+        pushPlanner->addDelete(file);
     }
-    if(QMessageBox::question(this, "Please Confirm actions", "Do you really want to perform this actions?") != QMessageBox::Yes)
+    pushPlanner->setInformationFile(settings->settings.infoReleaseFilename);
+    pushPlanner->build();
+    QList<PushJournal::pushStep> steps = pushPlanner->steps();
+    ui->console->append("GOING TO PERFORM:");
+    foreach (PushJournal::pushStep step, steps) {
+        ui->console->append(QString("%0 %1").arg(PushJournal::stepTypeToString(step.type)).arg(step.remotePath));
+    }
+    if(QMessageBox::question(this, "Please Confirm actions", QString("Do you really want to perform this actions?\n\n%0").arg(pushPlanner->summary())) != QMessageBox::Yes)
         return;
-    if(ftpLogin()) {
-        foreach (QString file, filesToDelete) {
-            ftpOperations.insert(ftp->remove(file), QString("Removing file %0 from server").arg(file));
-        }
-        foreach (QString file, filesToPush) {
-            QFile m_file(localFiles.value(file));
-            if(m_file.open(QIODevice::ReadOnly)) {
-                ui->console->append(QFileInfo(file).path());
-                if(ftpCreateDirectory((QFileInfo(file).path()))) {
-                    qDebug()<<"FILE="<<file;
-                    ftp->cd("~");
-                    ftpOperations.insert(ftp->put(m_file.readAll(), file), QString("Pushing file %0 to %1 on server").arg(localFiles.value(file)).arg(file));
-                }
-                else {
-                    ui->console->append("Failed to create directory");
-                }
-            }
-            else {
-                ui->console->append(QString("ERROR could not open local file %0. Skipping").arg(localFiles.value(file)));
-            }
+    if(!pushJournal->begin(steps, xml)) {
+        QMessageBox::warning(this, "Can't push", "Could not save the new information file locally, nothing was pushed");
+        return;
+    }
+    processStatusChange(STATUS_PUSHING);
+    ftpLogin().andThen([this]() { return runPush(); }).onFinished([this](const FtpFuture &result) {
+        processStatusChange(oldStatus);
+        if(!result.isSuccess()) {
+            QMessageBox::warning(this, "Push failed", "The push did not complete, the information file on the server was left untouched. Push again or restart the application to resume it");
+            return;
         }
-        ui->console->append("Pushing xml information file");
-        ftpOperations.insert(ftp->put(xml.toUtf8(), settings->settings.infoReleaseFilename), QString("Pushing file:%0").arg(settings->settings.infoReleaseFilename));
         QList<TableWidgetData*> dataTables;
         dataTables << testReleaseTable << releaseTable << oldReleaseTable;
         foreach (TableWidgetData *table, dataTables) {
-            foreach (int key, table->dataActionPerItem.keys()) {
-                table->dataActionPerItem[key].action = TableWidgetData::ACTION_NONE;
+            foreach (int key, table->items().keys()) {
+                table->setAction(key, TableWidgetData::ACTION_NONE);
             }
             fillTable(table);
         }
+    });
+}
+
+// Runs every step of the journal that is not done yet. The information file
+// is what clients read, so it must never point at files that are still
+// uploading or already gone: artifacts go first, the new catalog is swapped
+// in with a single rename once they are all there, and only then are old
+// files deleted.
+FtpFuture MainWindow::runPush()
+{
+    return pushDirectories().andThen([this]() {
+        return pushUploads();
+    }).andThen([this]() {
+        return pushInformationFile();
+    }).andThen([this]() {
+        return pushDeletes();
+    }).then([this](const FtpFuture &result) {
+        if(result.isSuccess()) {
+            pushJournal->clear();
+            ui->console->append("Push completed");
+        }
+        return result;
+    });
+}
+
+// Directories are created one after the other, sibling paths share parents
+// that would otherwise be created twice
+FtpFuture MainWindow::pushDirectories()
+{
+    FtpFuture created = FtpFuture::succeeded();
+    foreach (int i, pushJournal->stepsOfType(PushJournal::STEP_MKDIR)) {
+        if(pushJournal->step(i).state == PushJournal::STATE_DONE)
+            continue;
+        created = created.then([this, i](const FtpFuture &) {
+            ui->console->append(pushJournal->step(i).remotePath);
+            return ftpCreateDirectory(pushJournal->step(i).remotePath).then([this, i](const FtpFuture &result) {
+                if(result.isSuccess())
+                    pushJournal->setState(i, PushJournal::STATE_DONE);
+                else {
+                    ui->console->append("Failed to create directory");
+                    pushJournal->setState(i, PushJournal::STATE_FAILED);
+                }
+                return result;
+            });
+        });
     }
+    return created.then([this](const FtpFuture &) {
+        if(!pushJournal->allDone(PushJournal::STEP_MKDIR))
+            return FtpFuture::failed("Not all directories could be created");
+        return FtpFuture::succeeded();
+    });
 }
 
+// Files are checked against the server and uploaded one after the other, in
+// journal order, like the directories. Files left on the server by an
+// earlier, interrupted push don't need to be sent again.
+FtpFuture MainWindow::pushUploads()
+{
+    FtpFuture uploaded = FtpFuture::succeeded();
+    QSharedPointer<qint64> bytesSent(new qint64(0));
+    QSharedPointer<QElapsedTimer> transferTimer(new QElapsedTimer);
+    foreach (int i, pushJournal->stepsOfType(PushJournal::STEP_PUT)) {
+        if(pushJournal->step(i).state == PushJournal::STATE_DONE)
+            continue;
+        uploaded = uploaded.then([=](const FtpFuture &) {
+            PushJournal::pushStep step = pushJournal->step(i);
+            if(!QFile::exists(step.localPath)) {
+                ui->console->append(QString("ERROR could not open local file %0. Skipping").arg(step.localPath));
+                pushJournal->setState(i, PushJournal::STATE_FAILED);
+                return FtpFuture::failed(QString("Could not open local file %0").arg(step.localPath));
+            }
+            return ftpRemoteFileSize(step.remotePath).then([=](const FtpFuture &size) {
+                qint64 remoteSize = size.value().toLongLong();
+                return ftpRemoteFileMatches(step.localPath, step.remotePath, step.md5, remoteSize).then([=](const FtpFuture &matches) {
+                    if(matches.value().toBool()) {
+                        ui->console->append(QString("%0 is already on the server, skipping").arg(step.remotePath));
+                        pushJournal->setState(i, PushJournal::STATE_DONE);
+                        return FtpFuture::succeeded();
+                    }
+                    if(!transferTimer->isValid())
+                        transferTimer->start();
+                    pushJournal->setState(i, PushJournal::STATE_RUNNING);
+                    return ftpPutFile(step.localPath, step.remotePath, step.md5, remoteSize).then([=](const FtpFuture &put) {
+                        pushJournal->setState(i, put.isSuccess() ? PushJournal::STATE_DONE : PushJournal::STATE_FAILED);
+                        if(put.isSuccess())
+                            *bytesSent += put.value().toLongLong();
+                        return put;
+                    });
+                });
+            });
+        });
+    }
+    return uploaded.then([=](const FtpFuture &) {
+        if(!pushJournal->allDone(PushJournal::STEP_PUT)) {
+            ui->console->append("Not all files reached the server, the information file was NOT updated");
+            return FtpFuture::failed("Not all files reached the server");
+        }
+        if(transferTimer->isValid())
+            pushPlanner->recordTransfer(*bytesSent, transferTimer->elapsed());
+        return FtpFuture::succeeded();
+    });
+}
+
+FtpFuture MainWindow::pushInformationFile()
+{
+    FtpFuture published = FtpFuture::succeeded();
+    foreach (int i, pushJournal->stepsOfType(PushJournal::STEP_PUBLISH)) {
+        if(pushJournal->step(i).state == PushJournal::STATE_DONE)
+            continue;
+        published = published.andThen([this, i]() {
+            return ftpPublishInformationFile(pushJournal->informationFile()).then([this, i](const FtpFuture &result) {
+                pushJournal->setState(i, result.isSuccess() ? PushJournal::STATE_DONE : PushJournal::STATE_FAILED);
+                return result;
+            });
+        });
+    }
+    return published;
+}
+
+// The new catalog is live; files that could not be deleted are only stale
+// leftovers and don't make the push incomplete
+FtpFuture MainWindow::pushDeletes()
+{
+    QList<FtpFuture> deletes;
+    foreach (int i, pushJournal->stepsOfType(PushJournal::STEP_DELETE)) {
+        if(pushJournal->step(i).state == PushJournal::STATE_DONE)
+            continue;
+        pushJournal->setState(i, PushJournal::STATE_RUNNING);
+        deletes.append(asyncFtp->remove(pushJournal->step(i).remotePath).then([this, i](const FtpFuture &result) {
+            pushJournal->setState(i, result.isSuccess() ? PushJournal::STATE_DONE : PushJournal::STATE_FAILED);
+            if(!result.isSuccess())
+                ui->console->append(QString("WARNING %0 could not be removed from the server").arg(pushJournal->step(i).remotePath));
+            return result;
+        }));
+    }
+    return FtpFuture::whenAll(deletes).then([](const FtpFuture &) {
+        return FtpFuture::succeeded();
+    });
+}
+
+void MainWindow::resumeInterruptedPush()
+{
+    ui->console->append("The last push did not complete:");
+    for(int i = 0; i < pushJournal->count(); ++i) {
+        PushJournal::pushStep step = pushJournal->step(i);
+        ui->console->append(QString("%0 %1: %2").arg(PushJournal::stepTypeToString(step.type)).arg(step.remotePath).arg(PushJournal::stepStateToString(step.state)));
+    }
+    if(QMessageBox::question(this, "Interrupted push found", "The last push did not complete. Do you want to resume it now?") != QMessageBox::Yes) {
+        pushJournal->clear();
+        QDir(workingRoot).removeRecursively();
+        return;
+    }
+    processStatusChange(STATUS_PUSHING);
+    ftpLogin().andThen([this]() { return runPush(); }).onFinished([this](const FtpFuture &result) {
+        processStatusChange(oldStatus);
+        if(result.isSuccess())
+            QMessageBox::information(this, "Push completed", "The interrupted push was completed, fetch the information file to see the result");
+        else
+            QMessageBox::warning(this, "Push failed", "The push still did not complete, restart the application to try again");
+    });
+}
 
 void MainWindow::onMakeReleaseButtonPressed()
 {
     QList<TableWidgetData*> tableList;
     tableList << testReleaseTable << releaseTable << oldReleaseTable;
     foreach (TableWidgetData *table, tableList) {
-        foreach (TableWidgetData::dataActionStruct data, table->dataActionPerItem.values()) {
+        foreach (TableWidgetData::dataActionStruct data, table->items().values()) {
             if(data.action != TableWidgetData::ACTION_NONE) {
                 QMessageBox::warning(this, "Can't make release", "Your working tables still have changes not submited to server, please push them and try again");
                 return;
@@ -1141,39 +1420,38 @@ void MainWindow::onMakeReleaseButtonPressed()
     }
     if(QMessageBox::question(this, "Please Confirm actions", "Do you really want to move the current test releases to the ALFA release?") != QMessageBox::Yes)
         return;
-    QHash<int, TableWidgetData::dataActionStruct> releaseData = releaseTable->dataActionPerItem;
-    QHash<int, TableWidgetData::dataActionStruct> oldReleaseData = oldReleaseTable->dataActionPerItem;
-
-    foreach (int tkey, testReleaseTable->dataActionPerItem.keys()) {
-        foreach (int key, releaseTable->dataActionPerItem.keys()) {
-            if(testReleaseTable->dataActionPerItem.value(tkey).data.type == releaseTable->dataActionPerItem.value(key).data.type &&
-                    testReleaseTable->dataActionPerItem.value(tkey).data.osType == releaseTable->dataActionPerItem.value(key).data.osType &&
-                    testReleaseTable->dataActionPerItem.value(tkey).data.hwType == releaseTable->dataActionPerItem.value(key).data.hwType) {
-                if(testReleaseTable->dataActionPerItem.value(tkey).data.osType == xmlParser::OS_EMBEDED)
-                    ui->console->append(QString("Same %0 file already exists for %1 on current releases moving it to old releases").arg(xmlParser::softTypeToString(testReleaseTable->dataActionPerItem.value(tkey).data.type)).arg(xmlParser::hwTypeToStringHash.value(testReleaseTable->dataActionPerItem.value(tkey).data.hwType)));
-                else
-                    ui->console->append(QString("Same %0 file already exists for %1 on current releases moving it to old releases").arg(xmlParser::softTypeToString(testReleaseTable->dataActionPerItem.value(tkey).data.type)).arg(xmlParser::osTypeToString(testReleaseTable->dataActionPerItem.value(tkey).data.osType)));
-                TableWidgetData::dataActionStruct temp;
-                temp.data = releaseTable->dataActionPerItem.value(key).data;
-                temp.action = TableWidgetData::ACTION_CHANGED_METADATA;
-                oldReleaseData.insert(getFirstFreeIndex(oldReleaseData), temp);
-                releaseData.remove(key);
-                break;
-            }
-        }
-        TableWidgetData::dataActionStruct temp;
-        temp.data = testReleaseTable->dataActionPerItem.value(tkey).data;
-        temp.action = TableWidgetData::ACTION_CHANGED_METADATA;
-        releaseData.insert(getFirstFreeIndex(releaseData), temp);
+    // every test item takes the place of the newest current item of its
+    // target, if any; nothing changes until the UAVO check passes
+    QHash<int, int> replaced;
+    QSet<int> replacedKeys;
+    foreach (int tkey, testReleaseTable->items().keys()) {
+        const xmlParser::softData &data = testReleaseTable->item(tkey).data;
+        int key = releaseTable->latest(TableWidgetData::targetOf(data));
+        if(key == -1 || replacedKeys.contains(key))
+            continue;
+        if(data.osType == xmlParser::OS_EMBEDED)
+            ui->console->append(QString("Same %0 file already exists for %1 on current releases moving it to old releases").arg(xmlParser::softTypeToString(data.type)).arg(xmlParser::hwTypeToStringHash.value(data.hwType)));
+        else
+            ui->console->append(QString("Same %0 file already exists for %1 on current releases moving it to old releases").arg(xmlParser::softTypeToString(data.type)).arg(xmlParser::osTypeToString(data.osType)));
+        replaced.insert(tkey, key);
+        replacedKeys.insert(key);
     }
     QString uavHash;
     bool allEqual = true;
     ui->console->append("Checking if all release assets share the same UAVO");
-    foreach (TableWidgetData::dataActionStruct data, releaseData.values()) {
-        if(data.data.type != xmlParser::SOFT_UPDATER) {
+    QList<const xmlParser::softData*> releaseData;
+    foreach (int key, releaseTable->items().keys()) {
+        if(!replacedKeys.contains(key))
+            releaseData.append(&releaseTable->item(key).data);
+    }
+    foreach (int tkey, testReleaseTable->items().keys()) {
+        releaseData.append(&testReleaseTable->item(tkey).data);
+    }
+    foreach (const xmlParser::softData *data, releaseData) {
+        if(data->type != xmlParser::SOFT_UPDATER) {
             if(uavHash.isEmpty())
-                uavHash = data.data.uavHash;
-            else if(data.data.uavHash != uavHash) {
+                uavHash = data->uavHash;
+            else if(data->uavHash != uavHash) {
                 allEqual = false;
                 break;
             }
@@ -1185,16 +1463,31 @@ void MainWindow::onMakeReleaseButtonPressed()
         return;
     }
     ui->console->append("No UAVO Hash inconsistencies found");
-    testReleaseTable->dataActionPerItem.clear();
-    releaseTable->dataActionPerItem = releaseData;
-    oldReleaseTable->dataActionPerItem = oldReleaseData;
+    foreach (int tkey, testReleaseTable->items().keys()) {
+        TableWidgetData::dataActionStruct temp;
+        temp.action = TableWidgetData::ACTION_CHANGED_METADATA;
+        if(replaced.contains(tkey)) {
+            int key = replaced.value(tkey);
+            temp.data = releaseTable->item(key).data;
+            oldReleaseTable->insert(temp);
+            releaseTable->remove(key);
+        }
+        temp.data = testReleaseTable->item(tkey).data;
+        releaseTable->insert(temp);
+    }
+    testReleaseTable->clear();
     fillTable(testReleaseTable);
     fillTable(releaseTable);
     fillTable(oldReleaseTable);
     QMessageBox::information(this, "Make release succeeded", "Check new tables and push release if everything looks OK");
 }
 
-bool MainWindow::ftpLogin() {
+FtpFuture MainWindow::ftpLogin() {
+    if(ftp->state() == QFtp::LoggedIn)
+        return FtpFuture::succeeded();
+    // a login still in progress is shared by everyone asking for one
+    if(!ftpLoginResult.isFinished())
+        return ftpLoginResult;
     ftpCredentials::credentials cred;
     if(!settings->settings.ftpPassword.isEmpty() && !settings->settings.ftpUserName.isEmpty()) {
         ui->console->append(QString("Using stored FTP credentials, username=%0").arg(settings->settings.ftpUserName));
@@ -1210,80 +1503,279 @@ bool MainWindow::ftpLogin() {
             settings->saveSettings();
         }
     }
-    if(ftp->state() != QFtp::LoggedIn) {
-        QEventLoop loop;
-        bool statusOK = false;
-        connect(ftp, SIGNAL(stateChanged(int)), &loop, SLOT(quit()));
-        connect(ftp, SIGNAL(commandFinished(int,bool)), &loop, SLOT(quit()));
-        int ftpID = ftp->connectToHost(settings->settings.ftpServerUrl);
-        ftpOperations.insert(ftpID, "Connect to host");
-        while(!statusOK) {
-            loop.exec();
-            if(ftp->error() != QFtp::NoError) {
-                return false;
-            }
-            if(ftp->state() == QFtp::Connected)
-                statusOK = true;
-        }
-        statusOK = false;
-        ftpOperations.insert(ftp->login(cred.username, cred.password), "Logging in to host");
-        while(!statusOK) {
-            loop.exec();
-            if(ftp->error() != QFtp::NoError) {
-                return false;
-            }
-            if(ftp->state() == QFtp::LoggedIn)
-                statusOK = true;
-        }
+    if(ftp->state() != QFtp::Connected)
+        ftpLoginResult = asyncFtp->connectToHost(settings->settings.ftpServerUrl);
+    else
+        ftpLoginResult = FtpFuture::succeeded();
+    ftpLoginResult = ftpLoginResult.andThen([this, cred]() {
+        return asyncFtp->login(cred.username, cred.password);
+    });
+    return ftpLoginResult;
+}
+
+// Creates every missing component of dir, which is relative to the login
+// directory
+FtpFuture MainWindow::ftpCreateDirectory(QString dir)
+{
+    return ftpCreateDirectoryLevel(dir.split("/", QString::SkipEmptyParts), 0);
+}
+
+FtpFuture MainWindow::ftpCreateDirectoryLevel(QStringList dirs, int level)
+{
+    if(level >= dirs.length())
+        return FtpFuture::succeeded();
+    QString parent = QStringList(dirs.mid(0, level)).join("/");
+    QString wanted = dirs.at(level);
+    QString path = parent.isEmpty() ? wanted : parent + "/" + wanted;
+    // only directories matter here, and the listing can stop as soon as the
+    // one we are looking for shows up
+    return asyncFtp->list(parent,
+                          [](const QUrlInfo &info) { return info.isDir(); },
+                          [wanted](const QUrlInfo &info) { return info.isDir() && info.name() == wanted; }).then([=](const FtpFuture &listing) {
+        if(!listing.isSuccess())
+            return listing;
+        QUrlInfoList entries = listing.value().value<QUrlInfoList>();
+        int found = entries.indexOf(wanted);
+        bool exists = (found != -1) && entries.isDir(found);
+        qCDebug(lcFtp) << "Directory" << path << "listed" << entries.count() << "entries, exists:" << exists;
+        ui->console->append(QString("Checking if directory %0 exists on server:%1").arg(path).arg(exists));
+        FtpFuture created = exists ? FtpFuture::succeeded() : asyncFtp->mkdir(path);
+        return created.andThen([=]() {
+            return ftpCreateDirectoryLevel(dirs, level + 1);
+        });
+    });
+}
+
+// Uploads the information file under a temporary name and renames it over
+// the published one, so clients only ever see a complete file
+FtpFuture MainWindow::ftpPublishInformationFile(QByteArray xml)
+{
+    QString published = settings->settings.infoReleaseFilename;
+    QString temporary = published + ".tmp";
+    ui->console->append("Pushing xml information file");
+    return asyncFtp->put(xml, temporary).andThen([=]() {
+        return asyncFtp->rename(temporary, published).then([=](const FtpFuture &renamed) {
+            if(renamed.isSuccess())
+                return renamed;
+            // some servers refuse to rename over an existing file
+            ui->console->append(QString("Could not replace %0 in one step, removing it first").arg(published));
+            return asyncFtp->remove(published).andThen([=]() {
+                return asyncFtp->rename(temporary, published);
+            });
+        });
+    });
+}
+
+// Size of file on the server as the value of the future, -1 if it does not
+// exist or SIZE is not supported
+FtpFuture MainWindow::ftpRemoteFileSize(QString file)
+{
+    return asyncFtp->rawCommand("TYPE I").andThen([=]() {
+        return asyncFtp->rawCommand("SIZE " + file);
+    }).then([](const FtpFuture &reply) {
+        if(!reply.isSuccess() || reply.replyCode() != 213)
+            return FtpFuture::succeeded(qint64(-1));
+        return FtpFuture::succeeded(reply.replyText().trimmed().toLongLong());
+    });
+}
+
+// Digest replies differ between servers (HASH answers "MD5 0-1234 <digest> <file>",
+// XMD5 and friends only the digest or "<file> <digest>"); take the token that
+// has the length of a hex digest of the wanted kind
+static QString hexDigestIn(QString reply, int length)
+{
+    QRegExp hex(QString("^[0-9a-fA-F]{%0}$").arg(length));
+    foreach (QString token, reply.split(' ', QString::SkipEmptyParts)) {
+        if(hex.exactMatch(token))
+            return token.toLower();
     }
-    return true;
+    return QString();
 }
 
-bool MainWindow::ftpCreateDirectory(QString dir)
-{
-    int ftpCurrentPathIndexCheck = 0;
-    ftpLastListing.clear();
-    bool keepGoing = true;
-    QStringList dirs = dir.split("/");
-    dirs.insert(0,"~");
-    qDebug() << dirs;
-    dirs.removeAll("");
-    while(keepGoing) {
-        if(ftpCurrentPathIndexCheck < (dirs.length() -1)) {
-            ftpOperations.insert(ftp->cd(dirs.at(ftpCurrentPathIndexCheck)), "CD to " + dirs.at(ftpCurrentPathIndexCheck));
-            ftpLastListing.clear();
-            int opID = ftp->list();
-            ftpDirsCheckOperations.append(opID);
-            lastFtpOperationSuccess = false;
-            ftpOperations.insert(opID, QString("Listing directory %0 contents").arg(dirs.at(ftpCurrentPathIndexCheck)));
-            ftpDirCheckEventLoop.exec();
-            if(!lastFtpOperationSuccess)
-                return false;
-            bool exists = false;
-            foreach (QUrlInfo info, ftpLastListing) {
-                if(info.isDir()) {
-                    qDebug() << "INFO=" << info.name() << dirs.at(ftpCurrentPathIndexCheck + 1);
-                    if(info.name() == dirs.at(ftpCurrentPathIndexCheck + 1)) {
-                        exists = true;
-                    }
-                }
-            }
-            ui->console->append(QString("Checking if directory %0 exists on server:%1").arg(dirs.at(ftpCurrentPathIndexCheck + 1)).arg(exists));
-            if(!exists) {
-                opID = ftp->mkdir(dirs.at(ftpCurrentPathIndexCheck + 1));
-                lastFtpOperationSuccess = false;
-                ftpOperations.insert(opID, QString("Creating directory %0").arg(dirs.at(ftpCurrentPathIndexCheck +1)));
-                ftpMkDirOperations.append(opID);
-                ftpDirCheckEventLoop.exec();
-                if(!lastFtpOperationSuccess)
-                    return false;
-            }
-            ++ftpCurrentPathIndexCheck;
+// Hex digest of the first length bytes of filename, of all of it if length
+// is negative; empty if the file is shorter or can't be read
+static QString localDigest(QString filename, QCryptographicHash::Algorithm algorithm, qint64 length)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return QString();
+    QCryptographicHash hash(algorithm);
+    if(length < 0) {
+        if(!hash.addData(&file))
+            return QString();
+        return QString(hash.result().toHex());
+    }
+    while(length > 0) {
+        QByteArray block = file.read(qMin(length, qint64(1024 * 1024)));
+        if(block.isEmpty())
+            return QString();
+        hash.addData(block);
+        length -= block.size();
+    }
+    return QString(hash.result().toHex());
+}
+
+// Release files can be hundreds of megabytes, so they are hashed on a worker
+// thread; the value of the future is the digest
+static FtpFuture localDigestInBackground(QObject *context, QString filename, QCryptographicHash::Algorithm algorithm, qint64 length = -1)
+{
+    FtpPromise promise;
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(context);
+    QObject::connect(watcher, &QFutureWatcher<QString>::finished, [watcher, promise]() {
+        promise.resolve(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(localDigest, filename, algorithm, length));
+    return promise.future();
+}
+
+// Each check resolves with true or false if it could tell whether the files
+// match, and with an invalid value if the server could not answer it; the
+// first check that can tell decides
+static FtpFuture firstConclusive(QList<std::function<FtpFuture ()> > checks)
+{
+    if(checks.isEmpty())
+        return FtpFuture::succeeded(false);
+    std::function<FtpFuture ()> check = checks.takeFirst();
+    return check().then([checks](const FtpFuture &result) {
+        if(result.isSuccess() && result.value().isValid())
+            return FtpFuture::succeeded(result.value().toBool());
+        return firstConclusive(checks);
+    });
+}
+
+// A digest reply compared with the local digest, invalid if the reply holds
+// no digest
+static QVariant digestMatches(const FtpFuture &reply, int length, QString localDigest)
+{
+    QString remoteDigest = reply.isSuccess() ? hexDigestIn(reply.replyText(), length) : QString();
+    if(remoteDigest.isEmpty() || localDigest.isEmpty())
+        return QVariant();
+    return remoteDigest == localDigest;
+}
+
+// The value of the future is true if remoteFile, remoteSize bytes long on the
+// server, is byte-identical to localFile, whose md5 was recorded when the item
+// was created. The strongest digest the server offers is used: HASH, then
+// XMD5/XSHA256. A check the server advertises but then refuses, e.g. HASH
+// without MD5 enabled, falls through to the next one. Without any digest the
+// answer is false and the file is sent again; a matching size and modification
+// time don't prove the contents are the same.
+FtpFuture MainWindow::ftpRemoteFileMatches(QString localFile, QString remoteFile, QString md5, qint64 remoteSize)
+{
+    if(remoteSize != QFileInfo(localFile).size())
+        return FtpFuture::succeeded(false);
+    FtpFuture localMD5 = FtpFuture::succeeded(md5);
+    if(md5.isEmpty()) {
+        ui->console->append(QString("Calculating MD5 of %0").arg(localFile));
+        localMD5 = localDigestInBackground(this, localFile, QCryptographicHash::Md5);
+    }
+    return localMD5.then([=](const FtpFuture &digest) {
+        QString md5 = digest.value().toString().toLower();
+        if(md5.isEmpty())
+            return FtpFuture::succeeded(false);
+        QList<std::function<FtpFuture ()> > checks;
+        if(ftp->hasFeature("HASH")) {
+            checks.append([=]() {
+                return asyncFtp->rawCommand("OPTS HASH MD5").andThen([=]() {
+                    return asyncFtp->rawCommand("HASH " + remoteFile);
+                }).then([=](const FtpFuture &reply) {
+                    return FtpFuture::succeeded(digestMatches(reply, 32, md5));
+                });
+            });
         }
-        else {
-            keepGoing = false;
+        if(ftp->hasFeature("XMD5")) {
+            checks.append([=]() {
+                return asyncFtp->rawCommand("XMD5 " + remoteFile).then([=](const FtpFuture &reply) {
+                    return FtpFuture::succeeded(digestMatches(reply, 32, md5));
+                });
+            });
         }
+        if(ftp->hasFeature("XSHA256")) {
+            checks.append([=]() {
+                return localDigestInBackground(this, localFile, QCryptographicHash::Sha256).then([=](const FtpFuture &sha256) {
+                    return asyncFtp->rawCommand("XSHA256 " + remoteFile).then([=](const FtpFuture &reply) {
+                        return FtpFuture::succeeded(digestMatches(reply, 64, sha256.value().toString()));
+                    });
+                });
+            });
+        }
+        if(checks.isEmpty())
+            qCInfo(lcFtp) << "The server offers no digest of" << remoteFile << "so it is sent again";
+        return firstConclusive(checks);
+    });
+}
+
+// The value of the future is true only if the server confirms, with a HASH
+// limited by RANG to the first remoteSize bytes, that remoteFile is the start
+// of localFile. The range is reset afterwards so it can't leak into the next
+// transfer.
+FtpFuture MainWindow::ftpRemotePrefixMatches(QString localFile, QString remoteFile, qint64 remoteSize)
+{
+    if(!ftp->hasFeature("HASH") || !ftp->hasFeature("RANG"))
+        return FtpFuture::succeeded(false);
+    QString range = QString("0-%0").arg(remoteSize - 1);
+    return localDigestInBackground(this, localFile, QCryptographicHash::Md5, remoteSize).then([=](const FtpFuture &prefix) {
+        return asyncFtp->rawCommand("OPTS HASH MD5").andThen([=]() {
+            return asyncFtp->rawCommand(QString("RANG 0 %0").arg(remoteSize - 1));
+        }).andThen([=]() {
+            return asyncFtp->rawCommand("HASH " + remoteFile);
+        }).then([=](const FtpFuture &reply) {
+            bool matches = reply.isSuccess() && reply.replyCode() == 213
+                    && reply.replyText().split(' ', QString::SkipEmptyParts).contains(range)
+                    && digestMatches(reply, 32, prefix.value().toString()).toBool();
+            return asyncFtp->rawCommand("RANG 1 0").then([matches](const FtpFuture &) {
+                return FtpFuture::succeeded(matches);
+            });
+        });
+    });
+}
 
+// A shorter file with the same name on the server is usually an interrupted
+// upload of this very file, but names alone prove nothing: the updater is
+// always staged as "updater". Only the missing tail is sent when the server
+// confirms that it holds the start of the local file, and a resumed file is
+// checked as a whole before it counts as sent; anything else is sent from
+// the start. The value of the future is the number of bytes sent.
+FtpFuture MainWindow::ftpPutFile(QString localFile, QString remoteFile, QString md5, qint64 remoteSize)
+{
+    qint64 localSize = QFileInfo(localFile).size();
+    if(remoteSize <= 0 || remoteSize >= localSize)
+        return ftpSendFile(localFile, remoteFile, 0);
+    return ftpRemotePrefixMatches(localFile, remoteFile, remoteSize).then([=](const FtpFuture &prefix) {
+        if(!prefix.value().toBool()) {
+            ui->console->append(QString("Can't confirm the partial %0 on the server, uploading it from the start").arg(remoteFile));
+            return ftpSendFile(localFile, remoteFile, 0);
+        }
+        ui->console->append(QString("Resuming upload of %0 at byte %1 of %2").arg(remoteFile).arg(remoteSize).arg(localSize));
+        return ftpSendFile(localFile, remoteFile, remoteSize).then([=](const FtpFuture &sent) {
+            if(!sent.isSuccess())
+                return sent;
+            return ftpRemoteFileSize(remoteFile).then([=](const FtpFuture &size) {
+                return ftpRemoteFileMatches(localFile, remoteFile, md5, size.value().toLongLong());
+            }).then([=](const FtpFuture &matches) {
+                if(matches.value().toBool())
+                    return sent;
+                ui->console->append(QString("Resumed %0 does not match the local file, uploading it from the start").arg(remoteFile));
+                return ftpSendFile(localFile, remoteFile, 0);
+            });
+        });
+    });
+}
+
+FtpFuture MainWindow::ftpSendFile(QString localFile, QString remoteFile, qint64 offset)
+{
+    QFile *file = new QFile(localFile, this);
+    if(!file->open(QIODevice::ReadOnly)) {
+        ui->console->append(QString("ERROR could not open local file %0. Skipping").arg(localFile));
+        delete file;
+        return FtpFuture::failed(QString("Could not open local file %0").arg(localFile));
     }
-    return true;
+    qint64 bytes = file->size() - offset;
+    return asyncFtp->put(file, remoteFile, offset).then([file, bytes](const FtpFuture &result) {
+        file->deleteLater();
+        if(!result.isSuccess())
+            return result;
+        return FtpFuture::succeeded(bytes);
+    });
 }
@@ -28,16 +28,25 @@
 #define MAINWINDOW_H
 
 #include "qftp.h"
+#include "asyncftp.h"
 #include <QMainWindow>
 #include <xmlparser.h>
 #include <QTableWidget>
 #include <xmlparser.h>
 #include <QObject>
 #include <webfileutils.h>
-#include <QProcess>
-#include <QEventLoop>
 #include <settings.h>
+#include "pushjournal.h"
+#include "pushplanner.h"
+#include "ingestengine.h"
+#include "ingestbatch.h"
+#include "softcatalog.h"
+#include "catalogreader.h"
 #include <QBuffer>
+#include <QFile>
+#include <QSet>
+#include <QMap>
+#include <set>
 
 namespace Ui {
 class MainWindow;
@@ -67,13 +76,51 @@ public:
         }
     };
 
+    // What an item takes the place of: the type and board of embedded
+    // software, the type and OS of everything else
+    typedef quint32 target;
+
     TableWidgetData(QObject *parent, QTableWidget* table, QList<xmlParser::softData> data);
     QTableWidget *table;
-    QHash<int, dataActionStruct> dataActionPerItem;
+    const QHash<int, dataActionStruct> &items() const;
+    const dataActionStruct &item(int index) const;
+    int insert(const dataActionStruct &item);
+    void replace(int index, const dataActionStruct &item);
+    void setAction(int index, action newAction);
+    void remove(int index);
+    void clear();
+    int freeIndex() const;
+    QList<int> withTarget(target key) const;
+    QList<int> withMD5(QString md5) const;
+    int latest(target key) const;
+    QList<QString> digests() const;
+    static target targetOf(xmlParser::softTypeEnum type, xmlParser::osTypeEnum osType, quint16 hwType);
+    static target targetOf(const xmlParser::softData &data);
 signals:
     void currentRowChanged(int);
 private slots:
     void onCurrentCellChanged(int,int,int,int);
+private:
+    void addToIndex(int index, const xmlParser::softData &data);
+    void removeFromIndex(int index, const xmlParser::softData &data);
+    // Orders the items of a target from oldest to newest; items of the same
+    // date by name, md5 and finally by the order they were added in
+    struct order
+    {
+        QDateTime date;
+        QString name;
+        QString md5;
+        quint64 sequence;
+        bool operator<(const order &other) const;
+    };
+    QHash<int, dataActionStruct> dataActionPerItem;
+    QHash<target, QMap<order, int> > byTarget;
+    QHash<int, order> orderOfIndex;
+    quint64 nextSequence;
+    QHash<QString, QSet<int> > byMD5;
+    // unused indexes below the end of the used range
+    std::set<int> freeIndexes;
+    int endIndex;
 };
 
 class MainWindow : public QMainWindow
@@ -91,7 +138,8 @@ private:
                  STATUS_EDITING_RELEASE                             = 0x00000100,
                  STATUS_CREATING_ITEM                               = 0x00001000,
                  STATUS_PROCESSING_NEW_ITEM                         = 0x00010000,
-                 STATUS_PARSING_INFO_FILE                           = 0x00100000};
+                 STATUS_PARSING_INFO_FILE                           = 0x00100000,
+                 STATUS_PUSHING                                     = 0x01000000};
     void fillTable(TableWidgetData *);
     Ui::MainWindow *ui;
     webFileUtils *fileUtils;
@@ -99,33 +147,60 @@ private:
     TableWidgetData *releaseTable;
     TableWidgetData *testReleaseTable;
     TableWidgetData *oldReleaseTable;
-    int getFirstFreeIndex(TableWidgetData *data);
-    int getFirstFreeIndex(QHash<int, TableWidgetData::dataActionStruct> &data);
     status currentStatus;
     status oldStatus;
     void processStatusChange(status newStatus);
     int addNewItem(xmlParser::softData data);
     void deleteItem(xmlParser::softData data);
-    QProcess *process;
-    QEventLoop *eventLoop;
     QFtp *ftp;
     int tt;
     Settings *settings;
-    QHash<int, QString> ftpOperations;
-    QList<int> ftpDownloads;
+    AsyncFtp *asyncFtp;
     QString workingRoot;
     bool createNewItem(bool alreadyDownloaded, QByteArray data = QByteArray(), bool error = false, QString errorString = "");
-    bool saveDownloadedFile(QByteArray data, QString path, QString fileName);
-    QString currentFilename;
-    bool ftpLogin();
-    bool ftpCreateDirectory(QString dir);
-    QEventLoop ftpDirCheckEventLoop;
-    QList<int> ftpDirsCheckOperations;
-    QList<int> ftpMkDirOperations;
-    QList <QUrlInfo> ftpLastListing;
-    bool lastFtpOperationSuccess;
+    IngestEngine *ingestEngine;
+    IngestJob::request pendingIngest;
+    IngestJob::request ingestRequestFromForm();
+    void completeIngestRequest(IngestJob::request &request);
+    bool addIngestedItem(xmlParser::softData item, QString releaseDir);
+    IngestBatch *ingestBatch;
+    QNetworkAccessManager *packageNetwork;
+    FtpFuture downloadPackage(QString link);
+    FtpFuture fetchInformationFile(QSharedPointer<CatalogReader> reader);
+    void fetchAndShowInformationFile();
+    bool showInformationFile(CatalogReader &reader, QString remoteTag = QString());
+    void startIngestBatch(QList<IngestJob::request> requests, QSet<QString> knownDigests = QSet<QString>());
+    FtpFuture ftpLoginResult;
+    FtpFuture buildIndexResult;
+    FtpFuture ftpLogin();
+    FtpFuture ftpCreateDirectory(QString dir);
+    FtpFuture ftpCreateDirectoryLevel(QStringList dirs, int level);
+    FtpFuture ftpPublishInformationFile(QByteArray xml);
+    FtpFuture ftpRemoteFileSize(QString file);
+    FtpFuture ftpRemoteFileMatches(QString localFile, QString remoteFile, QString md5, qint64 remoteSize);
+    FtpFuture ftpRemotePrefixMatches(QString localFile, QString remoteFile, qint64 remoteSize);
+    FtpFuture ftpPutFile(QString localFile, QString remoteFile, QString md5, qint64 remoteSize);
+    FtpFuture ftpSendFile(QString localFile, QString remoteFile, qint64 offset);
+    PushJournal *pushJournal;
+    PushPlanner *pushPlanner;
+    FtpFuture runPush();
+    FtpFuture pushDirectories();
+    FtpFuture pushUploads();
+    FtpFuture pushInformationFile();
+    FtpFuture pushDeletes();
     void fillComboBoxes();
-    QString calculateMD5(QString filename);
+    void showCatalog(const SoftCatalog &catalog);
+    QString informationFileLink() const;
+    QString informationFileSource() const;
+    QString catalogSnapshotFile() const;
+    FtpFuture informationFileTag();
+    FtpFuture ftpModificationTag(QString file);
+    static QString httpModificationTag(QNetworkReply *reply);
+    void revalidateCatalogSnapshot();
+    void confirmCatalogSnapshot();
+    bool hasPendingChanges() const;
+    SoftCatalog::snapshotInfo catalogSnapshot;
+    bool showingSnapshot;
 private slots:
     void onFetchButtonPressed();
     void onPushButtonPressed();
@@ -134,16 +209,21 @@ private slots:
     void onCreateItemButtonPressed();
     void onCancelNewItemButtonPressed();
     void onProcessNewItemButtonPressed();
-    void onWebFileDownloaded(bool, QByteArray, QString, QNetworkReply::NetworkError);
     void onDownloadProgress(qint64, qint64);
-    void onReadyReadFromProcess();
     void onSettingsButtonPressed();
     void onFtpStateChanged(int);
-    void onFtpOperationEnded(int, bool);
+    void onFtpOperationFinished(QString description, bool error, QString errorString);
     void onFtpTransferProgress(qint64, qint64);
-    bool processInformationFile(QByteArray array);
     void onComboboxesCurrentChanged(int index);
     void onXMLParserMessage(QString text);
-    void onftpListInfo(QUrlInfo);
+    void resumeInterruptedPush();
+    void loadCatalogSnapshot();
+    void onIngestStageChanged(int id, int stage);
+    void onIngestProgress(int id, qint64 done, qint64 total);
+    void onIngestLogMessage(int id, QString text);
+    void onIngestJobFinished(int id, bool success);
+    void onBatchItemsButtonPressed();
+    void onBuildServerButtonPressed();
+    void onIngestBatchFinished();
 };
 #endif // MAINWINDOW_H
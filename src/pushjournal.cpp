@@ -0,0 +1,175 @@
+/**
+ ******************************************************************************
+ * @file       pushjournal.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup PushJournal
+ * @{
+ * @brief Persisted plan of a push to the release server
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pushjournal.h"
+#include <QSettings>
+#include <QFile>
+#include <QSaveFile>
+
+PushJournal::PushJournal(QString filename, QObject *parent) : QObject(parent), m_filename(filename)
+{
+    load();
+}
+
+// The information file is written once, to its own file next to the
+// journal, before any step is recorded; step changes only rewrite the
+// small journal. False if the information file could not be written.
+bool PushJournal::begin(QList<PushJournal::pushStep> steps, QByteArray informationFile)
+{
+    QSaveFile file(informationFilePath());
+    if(!file.open(QIODevice::WriteOnly) || file.write(informationFile) != informationFile.size() || !file.commit())
+        return false;
+    m_steps = steps;
+    save();
+    return true;
+}
+
+void PushJournal::clear()
+{
+    m_steps.clear();
+    QFile::remove(m_filename);
+    QFile::remove(informationFilePath());
+}
+
+bool PushJournal::isPending() const
+{
+    return !m_steps.isEmpty();
+}
+
+int PushJournal::count() const
+{
+    return m_steps.count();
+}
+
+PushJournal::pushStep PushJournal::step(int index) const
+{
+    return m_steps.at(index);
+}
+
+QList<int> PushJournal::stepsOfType(PushJournal::stepTypeEnum type) const
+{
+    QList<int> ret;
+    for(int x = 0; x < m_steps.count(); ++x) {
+        if(m_steps.at(x).type == type)
+            ret.append(x);
+    }
+    return ret;
+}
+
+bool PushJournal::allDone(PushJournal::stepTypeEnum type) const
+{
+    foreach (pushStep step, m_steps) {
+        if(step.type == type && step.state != STATE_DONE)
+            return false;
+    }
+    return true;
+}
+
+void PushJournal::setState(int index, PushJournal::stepStateEnum state)
+{
+    m_steps[index].state = state;
+    save();
+}
+
+// Read from disk when the push gets to publishing it
+QByteArray PushJournal::informationFile() const
+{
+    QFile file(informationFilePath());
+    if(!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+QString PushJournal::informationFilePath() const
+{
+    return m_filename + ".xml";
+}
+
+QString PushJournal::stepTypeToString(PushJournal::stepTypeEnum type)
+{
+    switch (type) {
+    case STEP_MKDIR:
+        return "Create directory";
+    case STEP_PUT:
+        return "Upload";
+    case STEP_PUBLISH:
+        return "Publish";
+    case STEP_DELETE:
+        return "Delete";
+    }
+    return "Unknown";
+}
+
+QString PushJournal::stepStateToString(PushJournal::stepStateEnum state)
+{
+    switch (state) {
+    case STATE_PENDING:
+        return "pending";
+    case STATE_RUNNING:
+        return "interrupted";
+    case STATE_DONE:
+        return "done";
+    case STATE_FAILED:
+        return "failed";
+    }
+    return "unknown";
+}
+
+void PushJournal::load()
+{
+    QSettings journal(m_filename, QSettings::IniFormat);
+    int size = journal.beginReadArray("steps");
+    for(int x = 0; x < size; ++x) {
+        journal.setArrayIndex(x);
+        pushStep step;
+        step.type = (stepTypeEnum)journal.value("type").toInt();
+        step.state = (stepStateEnum)journal.value("state").toInt();
+        step.remotePath = journal.value("remote").toString();
+        step.localPath = journal.value("local").toString();
+        step.md5 = journal.value("md5").toString();
+        m_steps.append(step);
+    }
+    journal.endArray();
+}
+
+// written through on every change, the journal is only useful if it
+// survives the crash it is meant to recover from
+void PushJournal::save()
+{
+    QSettings journal(m_filename, QSettings::IniFormat);
+    journal.clear();
+    journal.beginWriteArray("steps", m_steps.count());
+    for(int x = 0; x < m_steps.count(); ++x) {
+        journal.setArrayIndex(x);
+        journal.setValue("type", (int)m_steps.at(x).type);
+        journal.setValue("state", (int)m_steps.at(x).state);
+        journal.setValue("remote", m_steps.at(x).remotePath);
+        journal.setValue("local", m_steps.at(x).localPath);
+        journal.setValue("md5", m_steps.at(x).md5);
+    }
+    journal.endArray();
+    journal.sync();
+}
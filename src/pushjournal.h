@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * @file       pushjournal.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup PushJournal
+ * @{
+ * @brief Persisted plan of a push to the release server
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PUSHJOURNAL_H
+#define PUSHJOURNAL_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+
+/**
+ * Every step of a push (directory creation, upload, publication of the
+ * information file and delete) together with its state. The journal is
+ * written to disk on every state change, so after a crash or a dropped
+ * connection the steps that did not complete can be run again. The new
+ * information file is kept in a file of its own, written once per push.
+ */
+class PushJournal : public QObject
+{
+    Q_OBJECT
+public:
+    enum stepTypeEnum {STEP_MKDIR, STEP_PUT, STEP_PUBLISH, STEP_DELETE};
+    enum stepStateEnum {STATE_PENDING, STATE_RUNNING, STATE_DONE, STATE_FAILED};
+    struct pushStep
+    {
+        PushJournal::stepTypeEnum type;
+        PushJournal::stepStateEnum state;
+        QString remotePath;
+        QString localPath;
+        QString md5;
+    };
+
+    PushJournal(QString filename, QObject *parent = 0);
+    bool begin(QList<pushStep> steps, QByteArray informationFile);
+    void clear();
+    bool isPending() const;
+    int count() const;
+    pushStep step(int index) const;
+    QList<int> stepsOfType(stepTypeEnum type) const;
+    bool allDone(stepTypeEnum type) const;
+    void setState(int index, stepStateEnum state);
+    QByteArray informationFile() const;
+    static QString stepTypeToString(stepTypeEnum type);
+    static QString stepStateToString(stepStateEnum state);
+private:
+    QString m_filename;
+    QList<pushStep> m_steps;
+    QString informationFilePath() const;
+    void load();
+    void save();
+};
+
+#endif // PUSHJOURNAL_H
@@ -0,0 +1,192 @@
+/**
+ ******************************************************************************
+ * @file       pushplanner.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup PushPlanner
+ * @{
+ * @brief Orders the operations of a push and estimates its cost
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pushplanner.h"
+#include <QSettings>
+#include <QFileInfo>
+#include <algorithm>
+
+// every step costs at least a few control connection round trips
+#define SECONDS_PER_STEP 1
+// weight of the newest measurement in the throughput average
+#define THROUGHPUT_WEIGHT 0.3
+// smaller transfers measure latency rather than throughput
+#define MIN_MEASURED_BYTES (256 * 1024)
+
+PushPlanner::PushPlanner(QString filename, QObject *parent) : QObject(parent), m_filename(filename), m_totalBytes(0)
+{
+    QSettings planner(m_filename, QSettings::IniFormat);
+    m_throughput = planner.value("throughput", 0.0).toDouble();
+}
+
+void PushPlanner::clear()
+{
+    m_uploads.clear();
+    m_deletes.clear();
+    m_informationFile.clear();
+    m_steps.clear();
+    m_totalBytes = 0;
+}
+
+void PushPlanner::addUpload(QString remotePath, QString localPath, QString md5)
+{
+    upload up;
+    up.remotePath = remotePath;
+    up.localPath = localPath;
+    up.md5 = md5;
+    up.size = QFileInfo(localPath).size();
+    m_uploads.append(up);
+}
+
+void PushPlanner::addDelete(QString remotePath)
+{
+    if(!m_deletes.contains(remotePath))
+        m_deletes.append(remotePath);
+}
+
+void PushPlanner::setInformationFile(QString remotePath)
+{
+    m_informationFile = remotePath;
+}
+
+void PushPlanner::build()
+{
+    m_steps.clear();
+    PushJournal::pushStep step;
+    step.state = PushJournal::STATE_PENDING;
+
+    // creating a/b/c also creates a/b, so only the deepest paths are kept
+    QStringList dirs;
+    foreach (upload up, m_uploads) {
+        QString dir = QFileInfo(up.remotePath).path();
+        if(!dirs.contains(dir))
+            dirs.append(dir);
+    }
+    QStringList leaves;
+    foreach (QString dir, dirs) {
+        bool covered = false;
+        foreach (QString other, dirs) {
+            if(other != dir && other.startsWith(dir + "/")) {
+                covered = true;
+                break;
+            }
+        }
+        if(!covered)
+            leaves.append(dir);
+    }
+    step.type = PushJournal::STEP_MKDIR;
+    foreach (QString dir, leaves) {
+        step.remotePath = dir;
+        m_steps.append(step);
+    }
+
+    // largest first, so an interrupted push has the expensive files behind it
+    QList<upload> uploads = m_uploads;
+    std::stable_sort(uploads.begin(), uploads.end(), [](const upload &a, const upload &b) { return a.size > b.size; });
+    m_totalBytes = 0;
+    step.type = PushJournal::STEP_PUT;
+    foreach (upload up, uploads) {
+        m_totalBytes += up.size;
+        step.remotePath = up.remotePath;
+        step.localPath = up.localPath;
+        step.md5 = up.md5;
+        m_steps.append(step);
+    }
+
+    step.localPath.clear();
+    step.md5.clear();
+    if(!m_informationFile.isEmpty()) {
+        step.type = PushJournal::STEP_PUBLISH;
+        step.remotePath = m_informationFile;
+        m_steps.append(step);
+    }
+    step.type = PushJournal::STEP_DELETE;
+    foreach (QString file, m_deletes) {
+        step.remotePath = file;
+        m_steps.append(step);
+    }
+}
+
+QList<PushJournal::pushStep> PushPlanner::steps() const
+{
+    return m_steps;
+}
+
+int PushPlanner::count(PushJournal::stepTypeEnum type) const
+{
+    int ret = 0;
+    foreach (PushJournal::pushStep step, m_steps) {
+        if(step.type == type)
+            ++ret;
+    }
+    return ret;
+}
+
+qint64 PushPlanner::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+// -1 until a transfer has been measured
+int PushPlanner::estimatedSeconds() const
+{
+    if(m_throughput <= 0)
+        return -1;
+    return int(m_totalBytes / m_throughput) + m_steps.count() * SECONDS_PER_STEP;
+}
+
+double PushPlanner::throughput() const
+{
+    return m_throughput;
+}
+
+void PushPlanner::recordTransfer(qint64 bytes, qint64 msecs)
+{
+    if(bytes < MIN_MEASURED_BYTES || msecs <= 0)
+        return;
+    double measured = bytes * 1000.0 / msecs;
+    if(m_throughput <= 0)
+        m_throughput = measured;
+    else
+        m_throughput = THROUGHPUT_WEIGHT * measured + (1 - THROUGHPUT_WEIGHT) * m_throughput;
+    QSettings planner(m_filename, QSettings::IniFormat);
+    planner.setValue("throughput", m_throughput);
+}
+
+QString PushPlanner::summary() const
+{
+    QString ret = QString("%0 directories to check, %1 files to upload (up to %2 KB), %3 files to delete")
+            .arg(count(PushJournal::STEP_MKDIR))
+            .arg(count(PushJournal::STEP_PUT))
+            .arg(m_totalBytes / 1024)
+            .arg(count(PushJournal::STEP_DELETE));
+    int seconds = estimatedSeconds();
+    if(seconds < 0)
+        ret += "\nEstimated time: unknown, no transfer has been measured yet";
+    else
+        ret += QString("\nEstimated time: %0m%1s at %2 KB/s").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0')).arg(int(m_throughput / 1024));
+    return ret;
+}
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * @file       pushplanner.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup PushPlanner
+ * @{
+ * @brief Orders the operations of a push and estimates its cost
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PUSHPLANNER_H
+#define PUSHPLANNER_H
+
+#include <QObject>
+#include "pushjournal.h"
+
+/**
+ * Turns the uploads and deletes collected from the tables into the ordered
+ * list of steps that PushJournal records and MainWindow::runPush executes:
+ * directories first (each path once, parents covered by their children),
+ * then uploads largest first, the information file and finally the deletes.
+ *
+ * The cost estimate uses the throughput measured on earlier pushes, which
+ * is kept in the given settings file.
+ */
+class PushPlanner : public QObject
+{
+    Q_OBJECT
+public:
+    PushPlanner(QString filename, QObject *parent = 0);
+    void clear();
+    void addUpload(QString remotePath, QString localPath, QString md5);
+    void addDelete(QString remotePath);
+    void setInformationFile(QString remotePath);
+    void build();
+    QList<PushJournal::pushStep> steps() const;
+    int count(PushJournal::stepTypeEnum type) const;
+    qint64 totalBytes() const;
+    int estimatedSeconds() const;
+    double throughput() const;
+    void recordTransfer(qint64 bytes, qint64 msecs);
+    QString summary() const;
+private:
+    struct upload
+    {
+        QString remotePath;
+        QString localPath;
+        QString md5;
+        qint64 size;
+    };
+    QString m_filename;
+    QList<upload> m_uploads;
+    QStringList m_deletes;
+    QString m_informationFile;
+    QList<PushJournal::pushStep> m_steps;
+    qint64 m_totalBytes;
+    double m_throughput;
+};
+
+#endif // PUSHPLANNER_H
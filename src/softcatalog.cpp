@@ -0,0 +1,510 @@
+/**
+ ******************************************************************************
+ * @file       softcatalog.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup SoftCatalog
+ * @{
+ * @brief Release items grouped by target and kept in date order
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "softcatalog.h"
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include <QFile>
+#include <QSaveFile>
+
+// Releases are written current, old, test; the buckets follow that order
+static const xmlParser::releaseTypeEnum releaseOrder[] = {xmlParser::RELEASE_CURRENT, xmlParser::RELEASE_OLD, xmlParser::RELEASE_TEST};
+
+static int releaseIndex(xmlParser::releaseTypeEnum release)
+{
+    switch (release) {
+    case xmlParser::RELEASE_CURRENT:
+        return 0;
+    case xmlParser::RELEASE_OLD:
+        return 1;
+    case xmlParser::RELEASE_TEST:
+        return 2;
+    }
+    return 0;
+}
+
+#define NO_DATE (std::numeric_limits<qint32>::min())
+
+SoftCatalog::SoftCatalog() : m_count(0)
+{
+    //id 0 is the empty string
+    intern(QString());
+}
+
+SoftCatalog::SoftCatalog(const QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> &list) : m_count(0)
+{
+    intern(QString());
+    for(QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData>::const_iterator i = list.constBegin(); i != list.constEnd(); ++i) {
+        insert(i.key(), i.value());
+    }
+}
+
+SoftCatalog::groupKey SoftCatalog::keyOf(xmlParser::releaseTypeEnum release, const xmlParser::softData &data)
+{
+    groupKey key;
+    key.release = release;
+    key.osType = data.osType;
+    key.hwType = data.osType == xmlParser::OS_EMBEDED ? data.hwType : 0;
+    key.type = data.type;
+    return key;
+}
+
+quint32 SoftCatalog::intern(const QString &text)
+{
+    QHash<QString, quint32>::const_iterator i = m_stringIds.constFind(text);
+    if(i != m_stringIds.constEnd())
+        return i.value();
+    quint32 id = m_strings.size();
+    m_strings.append(text);
+    m_stringIds.insert(text, id);
+    return id;
+}
+
+// Everything up to the last / is the prefix
+SoftCatalog::link SoftCatalog::makeLink(const QString &text)
+{
+    link l;
+    int split = text.lastIndexOf('/') + 1;
+    l.prefix = intern(text.left(split));
+    l.suffix = intern(text.mid(split));
+    return l;
+}
+
+SoftCatalog::digest SoftCatalog::makeDigest(const QString &text)
+{
+    digest d;
+    memset(d.bytes, 0, DIGEST_SIZE);
+    QByteArray bytes = QByteArray::fromHex(text.toLatin1());
+    if(bytes.size() <= DIGEST_SIZE && QString(bytes.toHex()) == text) {
+        d.size = bytes.size();
+        memcpy(d.bytes, bytes.constData(), bytes.size());
+    }
+    else {
+        quint32 id = intern(text);
+        d.size = DIGEST_TEXT;
+        memcpy(d.bytes, &id, sizeof(id));
+    }
+    return d;
+}
+
+QString SoftCatalog::linkText(const SoftCatalog::link &l) const
+{
+    return m_strings.at(l.prefix) + m_strings.at(l.suffix);
+}
+
+QString SoftCatalog::digestText(const SoftCatalog::digest &d) const
+{
+    if(d.size == DIGEST_TEXT) {
+        quint32 id;
+        memcpy(&id, d.bytes, sizeof(id));
+        return m_strings.at(id);
+    }
+    return QString(QByteArray((const char *)d.bytes, d.size).toHex());
+}
+
+bool SoftCatalog::isOlder(const SoftCatalog::record &a, const SoftCatalog::record &b) const
+{
+    if(a.julianDay != b.julianDay)
+        return a.julianDay < b.julianDay;
+    if(a.name != b.name)
+        return m_strings.at(a.name) < m_strings.at(b.name);
+    //binary digests compare like their hex text
+    if(a.md5.size == b.md5.size && a.md5.size != DIGEST_TEXT)
+        return memcmp(a.md5.bytes, b.md5.bytes, a.md5.size) < 0;
+    return digestText(a.md5) < digestText(b.md5);
+}
+
+static bool hwTypeLess(const SoftCatalog::board &b, quint16 hwType)
+{
+    return b.hwType < hwType;
+}
+
+void SoftCatalog::insert(xmlParser::releaseTypeEnum release, const xmlParser::softData &data)
+{
+    entry fields;
+    fields.date = data.date;
+    fields.name = data.name;
+    fields.uavHash = data.uavHash;
+    fields.md5 = data.md5;
+    fields.packageLink = data.packageLink.toString();
+    fields.releaseLink = data.releaseLink.toString();
+    fields.scriptLink = data.scriptLink.toString();
+    insert(keyOf(release, data), fields);
+}
+
+// The board and the place in the group are both found with a binary search;
+// the record goes after every record not newer than it
+void SoftCatalog::insert(const SoftCatalog::groupKey &key, const SoftCatalog::entry &fields)
+{
+    record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.julianDay = fields.date.isValid() ? (qint32)fields.date.toJulianDay() : NO_DATE;
+    rec.name = intern(fields.name);
+    rec.packageLink = makeLink(fields.packageLink);
+    rec.releaseLink = makeLink(fields.releaseLink);
+    rec.scriptLink = makeLink(fields.scriptLink);
+    rec.md5 = makeDigest(fields.md5);
+    rec.uavHash = makeDigest(fields.uavHash);
+    QVector<record> &records = bucket(key);
+    records.insert(std::upper_bound(records.begin(), records.end(), rec, [this](const record &a, const record &b) { return isOlder(a, b); }), rec);
+    ++m_count;
+}
+
+// The records of the group, the board is added if it doesn't exist yet
+QVector<SoftCatalog::record> &SoftCatalog::bucket(const SoftCatalog::groupKey &key)
+{
+    if(key.osType != xmlParser::OS_EMBEDED)
+        return m_software[releaseIndex(key.release)][key.osType][key.type];
+    QVector<board> &boards = m_boards[releaseIndex(key.release)];
+    QVector<board>::iterator i = std::lower_bound(boards.begin(), boards.end(), key.hwType, hwTypeLess);
+    if(i == boards.end() || i->hwType != key.hwType) {
+        board b;
+        b.hwType = key.hwType;
+        i = boards.insert(i, b);
+    }
+    return i->records[key.type];
+}
+
+void SoftCatalog::clear()
+{
+    for(int release = 0; release < RELEASE_COUNT; ++release) {
+        for(int os = 0; os < OS_COUNT; ++os) {
+            for(int type = 0; type < SOFT_COUNT; ++type) {
+                m_software[release][os][type].clear();
+            }
+        }
+        m_boards[release].clear();
+    }
+    m_strings.clear();
+    m_stringIds.clear();
+    intern(QString());
+    m_count = 0;
+}
+
+int SoftCatalog::count() const
+{
+    return m_count;
+}
+
+bool SoftCatalog::contains(xmlParser::releaseTypeEnum release) const
+{
+    int index = releaseIndex(release);
+    if(!m_boards[index].isEmpty())
+        return true;
+    for(int os = 0; os < OS_COUNT; ++os) {
+        for(int type = 0; type < SOFT_COUNT; ++type) {
+            if(!m_software[index][os][type].isEmpty())
+                return true;
+        }
+    }
+    return false;
+}
+
+// Visits the groups that have items in file order: release, OS, then
+// hardware id and type for the embedded boards or type for the rest
+void SoftCatalog::forEachGroup(SoftCatalog::groupVisitor visit) const
+{
+    groupKey key;
+    for(int release = 0; release < RELEASE_COUNT; ++release) {
+        key.release = releaseOrder[release];
+        for(int os = 0; os < OS_COUNT; ++os) {
+            key.osType = (xmlParser::osTypeEnum)os;
+            if(os == xmlParser::OS_EMBEDED) {
+                foreach (const board &b, m_boards[release]) {
+                    key.hwType = b.hwType;
+                    for(int type = 0; type < SOFT_COUNT; ++type) {
+                        key.type = (xmlParser::softTypeEnum)type;
+                        if(!b.records[type].isEmpty())
+                            visit(key, b.records[type]);
+                    }
+                }
+                continue;
+            }
+            key.hwType = 0;
+            for(int type = 0; type < SOFT_COUNT; ++type) {
+                key.type = (xmlParser::softTypeEnum)type;
+                if(!m_software[release][os][type].isEmpty())
+                    visit(key, m_software[release][os][type]);
+            }
+        }
+    }
+}
+
+const QVector<SoftCatalog::record> &SoftCatalog::group(const SoftCatalog::groupKey &key) const
+{
+    static const QVector<record> empty;
+    if(key.osType != xmlParser::OS_EMBEDED)
+        return m_software[releaseIndex(key.release)][key.osType][key.type];
+    const QVector<board> &boards = m_boards[releaseIndex(key.release)];
+    QVector<board>::const_iterator i = std::lower_bound(boards.constBegin(), boards.constEnd(), key.hwType, hwTypeLess);
+    if(i == boards.constEnd() || i->hwType != key.hwType)
+        return empty;
+    return i->records[key.type];
+}
+
+// The newest item of the group, false if the group is empty
+bool SoftCatalog::latest(const SoftCatalog::groupKey &key, xmlParser::softData &data) const
+{
+    const QVector<record> &records = group(key);
+    if(records.isEmpty())
+        return false;
+    data = item(key, records.last());
+    return true;
+}
+
+SoftCatalog::entry SoftCatalog::fields(const SoftCatalog::record &rec) const
+{
+    entry fields;
+    if(rec.julianDay != NO_DATE)
+        fields.date = QDate::fromJulianDay(rec.julianDay);
+    fields.name = m_strings.at(rec.name);
+    fields.uavHash = digestText(rec.uavHash);
+    fields.md5 = digestText(rec.md5);
+    fields.packageLink = linkText(rec.packageLink);
+    fields.releaseLink = linkText(rec.releaseLink);
+    fields.scriptLink = linkText(rec.scriptLink);
+    return fields;
+}
+
+xmlParser::softData SoftCatalog::item(const SoftCatalog::groupKey &key, const SoftCatalog::record &rec) const
+{
+    entry text = fields(rec);
+    xmlParser::softData data;
+    data.type = key.type;
+    data.osType = key.osType;
+    data.hwType = key.hwType;
+    data.name = text.name;
+    data.packageLink = QUrl(text.packageLink);
+    data.releaseLink = QUrl(text.releaseLink);
+    data.scriptLink = QUrl(text.scriptLink);
+    data.date = text.date;
+    data.uavHash = text.uavHash;
+    data.md5 = text.md5;
+    return data;
+}
+
+// The items of one release, in file order
+QList<xmlParser::softData> SoftCatalog::items(xmlParser::releaseTypeEnum release) const
+{
+    QList<xmlParser::softData> ret;
+    forEachGroup([&](const groupKey &key, const QVector<record> &records) {
+        if(key.release != release)
+            return;
+        foreach (const record &rec, records) {
+            ret.append(item(key, rec));
+        }
+    });
+    return ret;
+}
+
+QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> SoftCatalog::toHash() const
+{
+    QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> ret;
+    forEachGroup([&](const groupKey &key, const QVector<record> &records) {
+        foreach (const record &rec, records) {
+            ret.insert(key.release, item(key, rec));
+        }
+    });
+    return ret;
+}
+
+struct snapshotHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 recordSize;
+    quint32 stringCount;
+    quint32 groupCount;
+};
+
+struct snapshotGroup
+{
+    quint32 release;
+    quint32 osType;
+    quint32 hwType;
+    quint32 type;
+    quint32 count;
+};
+
+#define SNAPSHOT_MAGIC 0x43534252
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+// Strings are a QChar count and the UTF-16 data, padded to 4 bytes
+static void writeSnapshotString(QIODevice &file, const QString &text)
+{
+    quint32 size = text.size();
+    file.write((const char *)&size, sizeof(size));
+    file.write((const char *)text.constData(), size * sizeof(QChar));
+    if(size % 2)
+        file.write(QByteArray(sizeof(QChar), 0));
+}
+
+static bool readSnapshotString(const uchar *&data, const uchar *end, QString &text)
+{
+    quint32 size;
+    if(end - data < (qint64)sizeof(size))
+        return false;
+    memcpy(&size, data, sizeof(size));
+    data += sizeof(size);
+    qint64 bytes = (qint64(size) + (size % 2)) * sizeof(QChar);
+    if(end - data < bytes)
+        return false;
+    text = QString((const QChar *)data, size);
+    data += bytes;
+    return true;
+}
+
+// Written to a temporary file that replaces the old snapshot when complete
+bool SoftCatalog::saveSnapshot(QString filename, const SoftCatalog::snapshotInfo &info) const
+{
+    QSaveFile file(filename);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    quint32 groupCount = 0;
+    forEachGroup([&](const groupKey &, const QVector<record> &) { ++groupCount; });
+    snapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.recordSize = sizeof(record);
+    header.stringCount = m_strings.size();
+    header.groupCount = groupCount;
+    file.write((const char *)&header, sizeof(header));
+    writeSnapshotString(file, info.source);
+    writeSnapshotString(file, info.sourceMD5);
+    writeSnapshotString(file, info.remoteTag);
+    foreach (const QString &text, m_strings) {
+        writeSnapshotString(file, text);
+    }
+    forEachGroup([&](const groupKey &key, const QVector<record> &records) {
+        snapshotGroup group;
+        group.release = key.release;
+        group.osType = key.osType;
+        group.hwType = key.hwType;
+        group.type = key.type;
+        group.count = records.size();
+        file.write((const char *)&group, sizeof(group));
+        file.write((const char *)records.constData(), records.size() * sizeof(record));
+    });
+    return file.commit();
+}
+
+// Leaves the catalog empty and returns false if the snapshot can't be used
+bool SoftCatalog::loadSnapshot(QString filename, SoftCatalog::snapshotInfo &info)
+{
+    clear();
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    const uchar *data = file.map(0, file.size());
+    if(!data)
+        return false;
+    const uchar *end = data + file.size();
+    bool ok = false;
+    do {
+        snapshotHeader header;
+        if(end - data < (qint64)sizeof(header))
+            break;
+        memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+        if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+                header.byteOrder != SNAPSHOT_BYTE_ORDER || header.recordSize != sizeof(record))
+            break;
+        if(!readSnapshotString(data, end, info.source) || !readSnapshotString(data, end, info.sourceMD5) ||
+                !readSnapshotString(data, end, info.remoteTag))
+            break;
+        //every string takes at least its length, a larger count can't be right
+        if(header.stringCount > (end - data) / sizeof(quint32))
+            break;
+        m_strings.clear();
+        m_stringIds.clear();
+        m_strings.reserve(header.stringCount);
+        QString text;
+        while((quint32)m_strings.size() < header.stringCount && readSnapshotString(data, end, text)) {
+            m_stringIds.insert(text, m_strings.size());
+            m_strings.append(text);
+        }
+        if((quint32)m_strings.size() != header.stringCount || m_strings.isEmpty())
+            break;
+        quint32 groups = 0;
+        for(; groups < header.groupCount; ++groups) {
+            snapshotGroup group;
+            if(end - data < (qint64)sizeof(group))
+                break;
+            memcpy(&group, data, sizeof(group));
+            data += sizeof(group);
+            if(group.release >= RELEASE_COUNT || group.osType >= OS_COUNT || group.type >= SOFT_COUNT || group.hwType > 0xFFFF ||
+                    (end - data) / sizeof(record) < group.count)
+                break;
+            groupKey key;
+            key.release = (xmlParser::releaseTypeEnum)group.release;
+            key.osType = (xmlParser::osTypeEnum)group.osType;
+            key.hwType = group.hwType;
+            key.type = (xmlParser::softTypeEnum)group.type;
+            QVector<record> &records = bucket(key);
+            records.resize(group.count);
+            memcpy(records.data(), data, group.count * sizeof(record));
+            data += group.count * sizeof(record);
+            m_count += group.count;
+            if(!isValid(records))
+                break;
+        }
+        ok = (groups == header.groupCount);
+    } while(false);
+    file.close();
+    if(!ok) {
+        clear();
+        info = snapshotInfo();
+    }
+    return ok;
+}
+
+// Every string id of the records has to be in the pool
+bool SoftCatalog::isValid(const QVector<SoftCatalog::record> &records) const
+{
+    quint32 strings = m_strings.size();
+    foreach (const record &rec, records) {
+        if(rec.name >= strings || rec.packageLink.prefix >= strings || rec.packageLink.suffix >= strings ||
+                rec.releaseLink.prefix >= strings || rec.releaseLink.suffix >= strings ||
+                rec.scriptLink.prefix >= strings || rec.scriptLink.suffix >= strings)
+            return false;
+        if(!isValid(rec.md5, strings) || !isValid(rec.uavHash, strings))
+            return false;
+    }
+    return true;
+}
+
+bool SoftCatalog::isValid(const SoftCatalog::digest &d, quint32 strings)
+{
+    if(d.size != DIGEST_TEXT)
+        return d.size <= DIGEST_SIZE;
+    quint32 id;
+    memcpy(&id, d.bytes, sizeof(id));
+    return id < strings;
+}
@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file       softcatalog.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup [Group]
+ * @{
+ * @addtogroup SoftCatalog
+ * @{
+ * @brief Release items grouped by target and kept in date order
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SOFTCATALOG_H
+#define SOFTCATALOG_H
+
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <functional>
+#include "xmlparser.h"
+
+/**
+ * The items of the information file grouped by release, OS, hardware and
+ * software type, the way the file nests them. Every group is kept ordered
+ * as items are inserted: oldest date first, then by name and md5, and items
+ * equal in all three stay in insertion order.
+ *
+ * Groups live in fixed buckets indexed by the enums (release x OS x type);
+ * embedded items go to a per-release list of boards sorted by hardware id,
+ * each with a bucket per type. forEachGroup() walks the buckets in the order
+ * the file is written, without hashing or building temporary lists.
+ *
+ * Items are kept as compact records: the name and the links live in a
+ * string pool shared by the whole catalog, links split in a directory
+ * prefix and a file name so the few long server paths are stored once, and
+ * md5 and UAVO hashes are kept as binary digests. A softData, with its
+ * parsed QUrls, is only built when item() or items() asks for it.
+ *
+ * The catalog can be kept on disk as a binary snapshot: a versioned header,
+ * the string pool as UTF-16 and every group as its raw record array, all in
+ * native byte order. Loading maps the file and copies the arrays back, so it
+ * takes no parsing; a snapshot of another version or byte order is refused.
+ */
+class SoftCatalog
+{
+public:
+    struct groupKey
+    {
+        xmlParser::releaseTypeEnum release;
+        xmlParser::osTypeEnum osType;
+        quint16 hwType;
+        xmlParser::softTypeEnum type;
+    };
+    // The fields of an item as they appear on the information file
+    struct entry
+    {
+        QDate date;
+        QString name;
+        QString uavHash;
+        QString md5;
+        QString packageLink;
+        QString releaseLink;
+        QString scriptLink;
+    };
+    enum {DIGEST_SIZE = 20, DIGEST_TEXT = 0xFF};
+    struct link
+    {
+        quint32 prefix;
+        quint32 suffix;
+    };
+    // Lowercase hex is kept as bytes, anything else as a pool id in bytes
+    // with size DIGEST_TEXT
+    struct digest
+    {
+        quint8 size;
+        quint8 bytes[DIGEST_SIZE];
+    };
+    struct record
+    {
+        qint32 julianDay;
+        quint32 name;
+        link packageLink;
+        link releaseLink;
+        link scriptLink;
+        digest md5;
+        digest uavHash;
+    };
+    typedef std::function<void (const groupKey &key, const QVector<record> &records)> groupVisitor;
+    // Where a snapshot came from: the information file location, the md5
+    // of its contents and the server's modification tag (MDTM or ETag)
+    struct snapshotInfo
+    {
+        QString source;
+        QString sourceMD5;
+        QString remoteTag;
+    };
+
+    SoftCatalog();
+    SoftCatalog(const QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> &list);
+    void insert(xmlParser::releaseTypeEnum release, const xmlParser::softData &data);
+    void insert(const groupKey &key, const entry &fields);
+    void clear();
+    int count() const;
+    bool contains(xmlParser::releaseTypeEnum release) const;
+    void forEachGroup(groupVisitor visit) const;
+    const QVector<record> &group(const groupKey &key) const;
+    bool latest(const groupKey &key, xmlParser::softData &data) const;
+    entry fields(const record &rec) const;
+    xmlParser::softData item(const groupKey &key, const record &rec) const;
+    QList<xmlParser::softData> items(xmlParser::releaseTypeEnum release) const;
+    QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> toHash() const;
+    bool saveSnapshot(QString filename, const snapshotInfo &info) const;
+    bool loadSnapshot(QString filename, snapshotInfo &info);
+    static groupKey keyOf(xmlParser::releaseTypeEnum release, const xmlParser::softData &data);
+    enum {RELEASE_COUNT = xmlParser::RELEASE_OLD + 1, OS_COUNT = xmlParser::OS_EMBEDED + 1, SOFT_COUNT = xmlParser::SOFT_SETTINGS + 1};
+    struct board
+    {
+        quint16 hwType;
+        QVector<record> records[SOFT_COUNT];
+    };
+private:
+    QVector<record> &bucket(const groupKey &key);
+    quint32 intern(const QString &text);
+    link makeLink(const QString &text);
+    digest makeDigest(const QString &text);
+    QString linkText(const link &l) const;
+    QString digestText(const digest &d) const;
+    bool isOlder(const record &a, const record &b) const;
+    bool isValid(const QVector<record> &records) const;
+    static bool isValid(const digest &d, quint32 strings);
+    QVector<record> m_software[RELEASE_COUNT][OS_COUNT][SOFT_COUNT];
+    QVector<board> m_boards[RELEASE_COUNT];
+    QVector<QString> m_strings;
+    QHash<QString, quint32> m_stringIds;
+    int m_count;
+};
+
+Q_DECLARE_TYPEINFO(SoftCatalog::record, Q_PRIMITIVE_TYPE);
+
+#endif // SOFTCATALOG_H
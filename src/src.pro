@@ -7,9 +7,15 @@
 QT       += core gui
 QT       += webkitwidgets
 QT       += xml
+QT       += concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+CONFIG += c++11
+
+# debug statements are compiled out of release builds
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
 TARGET = ReleaseBuilder
 TEMPLATE = app
 
@@ -20,13 +26,32 @@ SOURCES += main.cpp\
     webfileutils.cpp \
     xmlparser.cpp \
     settings.cpp \
-    ftpcredentials.cpp
+    ftpcredentials.cpp \
+    pushjournal.cpp \
+    pushplanner.cpp \
+    asyncftp.cpp \
+    ingestjob.cpp \
+    ingestengine.cpp \
+    ingestbatch.cpp \
+    softcatalog.cpp \
+    catalogreader.cpp \
+    logging.cpp
 
 HEADERS  += mainwindow.h \
     webfileutils.h \
     xmlparser.h \
     settings.h \
-    ftpcredentials.h
+    ftpcredentials.h \
+    pushjournal.h \
+    pushplanner.h \
+    asyncftp.h \
+    ingestjob.h \
+    ingestengine.h \
+    ingestbatch.h \
+    softcatalog.h \
+    catalogreader.h \
+    catalogtags.h \
+    logging.h
 
 FORMS    += mainwindow.ui \
     settings.ui \
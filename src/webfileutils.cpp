@@ -30,7 +30,6 @@
 #include <QDebug>
 #include <QWebElementCollection>
 #include <QTimer>
-#include <QEventLoop>
 #include <QDir>
 
 webFileUtils::webFileUtils(QObject *parent):QObject(parent)
@@ -44,14 +43,26 @@ webFileUtils::~webFileUtils()
 
 }
 
-QList<webFileUtils::webFile> webFileUtils::getWebFiles(QUrl url)
+// Loads the page without blocking; the value of the future is the
+// QList<webFile> of the package links found on it
+FtpFuture webFileUtils::fetchWebFiles(QUrl url)
 {
-    QList<webFileUtils::webFile> list;
+    FtpPromise promise;
     QWebPage *webPage = new QWebPage(this);
-    QEventLoop loop;
-    connect(webPage->mainFrame(), SIGNAL(loadFinished(bool)), &loop, SLOT(quit()));
+    connect(webPage->mainFrame(), &QWebFrame::loadFinished, [webPage, promise](bool ok) {
+        if(ok)
+            promise.resolve(QVariant::fromValue(webFilesOf(webPage)));
+        else
+            promise.reject("Could not load the page");
+        webPage->deleteLater();
+    });
     webPage->mainFrame()->load(url);
-    loop.exec();
+    return promise.future();
+}
+
+QList<webFileUtils::webFile> webFileUtils::webFilesOf(QWebPage *webPage)
+{
+    QList<webFileUtils::webFile> list;
     QUrl baseUrl = webPage->mainFrame()->baseUrl();
 
     QWebElementCollection collection = webPage->mainFrame()->findAllElements("a");
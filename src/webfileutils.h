@@ -36,7 +36,9 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QFile>
-#include <QNetworkReply>
+#include "asyncftp.h"
+
+class QWebPage;
 
 class webFileUtils : public QObject
 {
@@ -49,7 +51,7 @@ public:
 
     webFileUtils(QObject *parent);
     ~webFileUtils();
-    QList<webFile> getWebFiles(QUrl url);
+    FtpFuture fetchWebFiles(QUrl url);
     void startFileDownload(QUrl url);
     QByteArray getDownloadedByteArray() const;
     bool saveDownloadedFile(QString path, QString &fileName, QString &completePath);
@@ -59,6 +61,7 @@ signals:
 private slots:
     void fileDownloaded(QNetworkReply* pReply);
 private:
+    static QList<webFile> webFilesOf(QWebPage *webPage);
     QNetworkRequest request;
     QNetworkAccessManager m_WebCtrl;
     QByteArray m_DownloadedData;
@@ -66,4 +69,6 @@ private:
     QString m_localFilename;
     QString m_remoteFilename;
 };
+Q_DECLARE_METATYPE(QList<webFileUtils::webFile>)
+
 #endif // WEBFILEUTILS_H
@@ -25,14 +25,20 @@
  */
 
 #include "xmlparser.h"
-#include <QDomDocument>
+#include "softcatalog.h"
+#include "catalogreader.h"
+#include "catalogtags.h"
+#include "logging.h"
+#include <QXmlStreamWriter>
+#include <QBuffer>
 #include <QFile>
-#include <QDebug>
 #include <QProcess>
 
-QHash<xmlParser::softTypeEnum, QString> xmlParser::softTypeToStringHash = xmlParser().softHashInit();
-QHash<xmlParser::osTypeEnum, QString> xmlParser::osTypeToStringHash = xmlParser().osHashInit();
-QHash<int, QString> xmlParser::hwTypeToStringHash = xmlParser().hwTypeInit();
+#define READ_CHUNK_SIZE 16384
+
+QHash<xmlParser::softTypeEnum, QString> xmlParser::softTypeToStringHash = xmlParser::softHashInit();
+QHash<xmlParser::osTypeEnum, QString> xmlParser::osTypeToStringHash = xmlParser::osHashInit();
+QHash<int, QString> xmlParser::hwTypeToStringHash = xmlParser::hwTypeInit();
 
 
 xmlParser::xmlParser(QObject *parent):QObject(parent)
@@ -46,277 +52,121 @@ xmlParser::~xmlParser()
 
 }
 
+// Pull parser over the information file: every record goes straight from
+// the reader into a SoftCatalog, no document tree is kept
 QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> xmlParser::parseXML(QString xml, bool &success)
 {
-    qDebug() << "Parsing:" << xml;
-    releaseTypeEnum releaseType;
-    osTypeEnum osType;
-    softTypeEnum softType;
-    QMultiHash<releaseTypeEnum, xmlParser::softData> ret;
-    QDomDocument *doc = new QDomDocument();
-    QString error;
-    int line = 0;
-    int column = 0;
-    if(!doc->setContent(xml, &error, &line, &column)) {
-        emit outputMessage(QString("Error(%0) parsing xml on line %1 column %2").arg(error).arg(line).arg(column));
-        QStringList lines = xml.split(QRegExp("[\r\n]"),QString::SkipEmptyParts);
-        if(line > 1)
-            emit outputMessage(lines.at(line - 1));
-        emit outputMessage(lines.at(line));
-        emit outputMessage(lines.at(line + 1));
-        success = false;
-        return QMultiHash<releaseTypeEnum, xmlParser::softData>();
-    }
-    QDomNode root = doc->firstChild();
-    foreach (QDomElement release, nodesToElementList(root.childNodes())) {
-        qDebug() << "Release type:" << release.tagName();
-        if(release.tagName() == "current_release")
-            releaseType = RELEASE_CURRENT;
-        else if(release.tagName() == "old_release")
-            releaseType = RELEASE_OLD;
-        else if(release.tagName() == "test_release")
-            releaseType = RELEASE_TEST;
-        else {
-            success = false;
-            return QMultiHash<releaseTypeEnum, xmlParser::softData>();
-        }
-        foreach(QDomElement os, nodesToElementList(release.childNodes())) {
-            qDebug() << "OS:" << os.tagName();
-            if(os.tagName() == "win32")
-                osType = OS_WIN32;
-            else if(os.tagName() == "win64")
-                osType = OS_WIN64;
-            else if(os.tagName() == "osx32")
-                osType = OS_OSX32;
-            else if(os.tagName() == "osx64")
-                osType = OS_OSX64;
-            else if(os.tagName() == "linux32")
-                osType = OS_LINUX32;
-            else if(os.tagName() == "linux64")
-                osType = OS_LINUX64;
-            else if(os.tagName() == "embeded")
-                osType = OS_EMBEDED;
-            else {
-                success = false;
-                return QMultiHash<releaseTypeEnum, xmlParser::softData>();
-            }
-            foreach (QDomElement soft, nodesToElementList(os.childNodes())) {
-                qDebug() << "Software type:" << soft.tagName();
-                if  (soft.tagName() == "gcs")
-                    softType = SOFT_GCS;
-                else if (soft.tagName() == "slim_gcs")
-                    softType = SOFT_SLIM_GCS;
-                else if (soft.tagName() == "updater")
-                    softType = SOFT_UPDATER;
-                else if (soft.tagName().startsWith("t")) {
-                    foreach (QDomElement embeded, nodesToElementList(soft.childNodes())) {
-                        qDebug() << "T:" << embeded.tagName();
-                        foreach (QDomElement s, nodesToElementList(embeded.childNodes())) {
-                            qDebug() << "T Softype:" << embeded.tagName();
-                            if(embeded.tagName() == "firmware")
-                                softType = SOFT_FIRMWARE;
-                            else if(embeded.tagName() == "settings")
-                                softType = SOFT_SETTINGS;
-                            else if(embeded.tagName() == "bootloader")
-                                softType = SOFT_BOOTLOADER;
-                            else {
-                                success = false;
-                                return QMultiHash<releaseTypeEnum, xmlParser::softData>();
-                            }
-                            ret.insert(releaseType, assembleSoftData(osType, softType, soft.tagName().remove(0, 1).toInt(), s));
-                        }
-                    }
-                }
-                else {
-                    success = false;
-                    return QMultiHash<releaseTypeEnum, xmlParser::softData>();
-                }
-                if ((softType != SOFT_FIRMWARE) && (softType != SOFT_SETTINGS) && (softType != SOFT_BOOTLOADER)) {
-                    foreach (QDomElement child, nodesToElementList(soft.childNodes())) {
-                        ret.insert(releaseType, assembleSoftData(osType, softType, 0, child));
-                    }
-                }
-            }
+    CatalogReader reader;
+    reader.addData(xml.toUtf8());
+    success = finishParse(reader);
+    if(!success) {
+        QStringList lines = xml.split(QRegExp("[\r\n]"));
+        int line = reader.lineNumber();
+        for(int x = line - 2; x <= line; ++x) {
+            if(x >= 0 && x < lines.length() && !lines.at(x).trimmed().isEmpty())
+                emit outputMessage(lines.at(x));
         }
     }
-    delete doc;
-    success = true;
-    return ret;
+    return reader.catalog().toHash();
 }
 
-xmlParser::softData xmlParser::assembleSoftData(osTypeEnum os, softTypeEnum soft, quint16 hwID, QDomElement element)
+QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> xmlParser::parseXML(QIODevice *device, bool &success)
 {
-    xmlParser::softData data;
-    data.osType = os;
-    data.type = soft;
-    data.hwType = hwID;
-    data.name = element.attribute("name");
-    data.uavHash = element.attribute("uavohash");
-    data.md5 = element.attribute("md5");
-    data.packageLink = QUrl(element.attribute("packageLink"));
-    data.releaseLink = QUrl(element.attribute("releaseLink"));
-    data.scriptLink = QUrl(element.attribute("scriptLink"));
-    data.date = QDate::fromString(element.tagName().remove(0, 1), "ddMMyyyy");
-    return data;
+    SoftCatalog catalog;
+    success = parseXML(device, catalog);
+    return catalog.toHash();
 }
 
-void xmlParser::processOSTypeList(QDomDocument *doc, QDomElement *element, QList<xmlParser::softData> data)
+// The catalog is left empty if the file can't be parsed
+bool xmlParser::parseXML(QIODevice *device, SoftCatalog &catalog)
 {
-    QMultiHash<osTypeEnum, xmlParser::softData> groupByOS;
-
-    foreach (xmlParser::softData item, data) {
-            groupByOS.insert(item.osType, item);
-    }
-    if (groupByOS.values(OS_WIN32).length()) {
-        QDomElement OSWin32 = doc->createElement("win32");
-        element->appendChild(OSWin32);
-        processSoftType(doc, OSWin32, groupByOS.values(OS_WIN32));
-    }
-    if (groupByOS.values(OS_WIN64).length()) {
-        QDomElement OSWin64 = doc->createElement("win64");
-        element->appendChild(OSWin64);
-        processSoftType(doc, OSWin64, groupByOS.values(OS_WIN64));
-    }
-    if (groupByOS.values(OS_OSX32).length()) {
-        QDomElement OSOsx32 = doc->createElement("osx32");
-        element->appendChild(OSOsx32);
-        processSoftType(doc, OSOsx32, groupByOS.values(OS_OSX32));
-    }
-    if (groupByOS.values(OS_OSX64).length()) {
-        QDomElement OSOsx64 = doc->createElement("osx64");
-        element->appendChild(OSOsx64);
-        processSoftType(doc, OSOsx64, groupByOS.values(OS_OSX64));
-    }
-    if (groupByOS.values(OS_LINUX32).length()) {
-        QDomElement OSLinux32 = doc->createElement("linux32");
-        element->appendChild(OSLinux32);
-        processSoftType(doc, OSLinux32, groupByOS.values(OS_LINUX32));
-    }
-    if (groupByOS.values(OS_LINUX64).length()) {
-        QDomElement OSLinux64 = doc->createElement("linux64");
-        element->appendChild(OSLinux64);
-        processSoftType(doc, OSLinux64, groupByOS.values(OS_LINUX64));
-    }
-    if (groupByOS.values(OS_EMBEDED).length()) {
-        QDomElement OSEmbeded = doc->createElement("embeded");
-        element->appendChild(OSEmbeded);
-        processHwType(doc, OSEmbeded, groupByOS.values(OS_EMBEDED));
+    CatalogReader reader;
+    while(!device->atEnd()) {
+        QByteArray chunk = device->read(READ_CHUNK_SIZE);
+        if(chunk.isEmpty())
+            break;
+        reader.addData(chunk);
     }
+    bool success = finishParse(reader);
+    catalog = reader.catalog();
+    return success;
 }
-void xmlParser::processSoftType(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data)
-{
-    QMultiHash<softTypeEnum, xmlParser::softData> groupBySoftType;
-
-    foreach (xmlParser::softData item, data) {
-            groupBySoftType.insert(item.type, item);
-    }
 
-    if(groupBySoftType.values(SOFT_GCS).length()) {
-        QDomElement Gcs = doc->createElement("gcs");
-        element.appendChild(Gcs);
-        xmlAddFields(doc, Gcs, groupBySoftType.values(SOFT_GCS));
-    }
-    if(groupBySoftType.values(SOFT_SLIM_GCS).length()) {
-        QDomElement Tbs = doc->createElement("slim_gcs");
-        element.appendChild(Tbs);
-        xmlAddFields(doc, Tbs, groupBySoftType.values(SOFT_SLIM_GCS));
-    }
-    if(groupBySoftType.values(SOFT_UPDATER).length()) {
-        QDomElement Updater = doc->createElement("updater");
-        element.appendChild(Updater);
-        xmlAddFields(doc, Updater, groupBySoftType.values(SOFT_UPDATER));
+bool xmlParser::finishParse(CatalogReader &reader)
+{
+    if(!reader.finish()) {
+        emit outputMessage(QString("Error(%0) parsing xml on line %1 column %2").arg(reader.errorString()).arg(reader.lineNumber()).arg(reader.columnNumber()));
+        return false;
     }
+    qCDebug(lcParser) << "Parsed" << reader.catalog().count() << "items from" << reader.size() << "bytes";
+    return true;
 }
-void xmlParser::processHwType(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data)
+
+// The group is already in date order
+static void xmlAddFields(QXmlStreamWriter &writer, const SoftCatalog &catalog, const QVector<SoftCatalog::record> &records)
 {
-    QMultiHash<quint16, xmlParser::softData> groupByHwType;
-    QMultiHash<softTypeEnum, xmlParser::softData> groupBySoftType;
-    foreach (xmlParser::softData item, data) {
-            groupByHwType.insert(item.hwType, item);
-    }
-    foreach (quint16 value, groupByHwType.keys().toSet().toList()) {
-        QDomElement e = doc->createElement("t" + QString::number(value));
-        element.appendChild(e);
-        groupBySoftType.clear();
-        foreach (xmlParser::softData item, groupByHwType.values(value)) {
-            groupBySoftType.insert(item.type, item);
-        }
-        if (groupBySoftType.values(SOFT_FIRMWARE).length()) {
-            QDomElement fw = doc->createElement("firmware");
-            e.appendChild(fw);
-            xmlAddFields(doc, fw, groupBySoftType.values(SOFT_FIRMWARE));
-        }
-        if (groupBySoftType.values(SOFT_BOOTLOADER).length()) {
-            QDomElement bl = doc->createElement("bootloader");
-            e.appendChild(bl);
-            xmlAddFields(doc, bl, groupBySoftType.values(SOFT_BOOTLOADER));
-        }
-        if (groupBySoftType.values(SOFT_SETTINGS).length()) {
-            QDomElement settings = doc->createElement("settings");
-            e.appendChild(settings);
-            xmlAddFields(doc, settings, groupBySoftType.values(SOFT_SETTINGS));
-        }
+    foreach (const SoftCatalog::record &record, records) {
+        SoftCatalog::entry item = catalog.fields(record);
+        writer.writeStartElement(item.date.toString("ddMMyyyy").prepend(QLatin1Char(CatalogTags::datePrefix)));
+        writer.writeAttribute("name", item.name);
+        writer.writeAttribute("uvohash", item.uavHash);
+        writer.writeAttribute("md5", item.md5);
+        writer.writeAttribute("packageLink", item.packageLink);
+        writer.writeAttribute("releaseLink", item.releaseLink);
+        writer.writeAttribute("scriptLink", item.scriptLink);
+        writer.writeEndElement();
     }
 }
 
-void xmlParser::xmlAddFields(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data)
+// Streams the information file into device as UTF-8, indented unless compact.
+// The catalog groups come in file order, so the release, OS and t<hw>
+// elements are opened and closed as the walk crosses from one to the next.
+void xmlParser::writeXML(const SoftCatalog &catalog, QIODevice *device, bool compact)
 {
-    if(data.length() == 0)
-        return;
-    xmlParser::softData mostRecent = data.at(0);
-    QList<xmlParser::softData> orderedData;
-    while(!data.isEmpty())
-    {
-        int t = 0;
-        for (int x = 0; x < data.length(); ++x) {
-            if(data.at(x).date < mostRecent.date)
-            {
-                t = x;
-                mostRecent = data.at(x);
-            }
+    QXmlStreamWriter writer(device);
+    writer.setAutoFormatting(!compact);
+    writer.setAutoFormattingIndent(4);
+    writer.writeDTD("<!DOCTYPE tauLabssoftware>");
+    writer.writeStartElement("root");
+    bool first = true;
+    SoftCatalog::groupKey last;
+    catalog.forEachGroup([&](const SoftCatalog::groupKey &key, const QVector<SoftCatalog::record> &records) {
+        bool embededType = (key.type == SOFT_FIRMWARE) || (key.type == SOFT_BOOTLOADER) || (key.type == SOFT_SETTINGS);
+        //items that don't fit the file layout are not written
+        if(embededType != (key.osType == OS_EMBEDED))
+            return;
+        bool newRelease = first || key.release != last.release;
+        bool newOS = newRelease || key.osType != last.osType;
+        bool newHw = newOS || key.hwType != last.hwType;
+        if(!first) {
+            writer.writeEndElement();
+            if(last.osType == OS_EMBEDED && newHw)
+                writer.writeEndElement();
+            if(newOS)
+                writer.writeEndElement();
+            if(newRelease)
+                writer.writeEndElement();
         }
-        data.removeAt(t);
-        orderedData.append(mostRecent);
-    }
-
-    foreach (xmlParser::softData item, orderedData) {
-        QDomElement e = doc->createElement("d" + item.date.toString("ddMMyyyy"));
-        e.setAttribute("name", item.name);
-        e.setAttribute("uvohash", item.uavHash);
-        e.setAttribute("md5", item.md5);
-        e.setAttribute("packageLink", item.packageLink.toString());
-        e.setAttribute("releaseLink", item.releaseLink.toString());
-        e.setAttribute("scriptLink", item.scriptLink.toString());
-        element.appendChild(e);
-    }
+        if(newRelease)
+            writer.writeStartElement(CatalogTags::releaseTag(key.release));
+        if(newOS)
+            writer.writeStartElement(CatalogTags::osTag(key.osType));
+        if(key.osType == OS_EMBEDED && newHw)
+            writer.writeStartElement(QString::number(key.hwType).prepend(QLatin1Char(CatalogTags::hwPrefix)));
+        writer.writeStartElement(CatalogTags::softTag(key.type));
+        xmlAddFields(writer, catalog, records);
+        first = false;
+        last = key;
+    });
+    writer.writeEndDocument();
 }
 
 QString xmlParser::convertSoftDataToXMLString(QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> list)
 {
-    QList<xmlParser::softData> releases = list.values(RELEASE_CURRENT);
-    QList<xmlParser::softData> oldReleases = list.values(RELEASE_OLD);
-    QList<xmlParser::softData> testReleases = list.values(RELEASE_TEST);
-    QDomDocument *doc = new QDomDocument("tauLabssoftware");
-    QDomElement root = doc->createElement("root");
-    doc->appendChild(root);
-    if(releases.length()) {
-        QDomElement releaseRoot = doc->createElement("current_release");
-        root.appendChild(releaseRoot);
-        processOSTypeList(doc, &releaseRoot, releases);
-    }
-    if(oldReleases.length()) {
-        QDomElement oldReleasesRoot = doc->createElement("old_release");
-        root.appendChild(oldReleasesRoot);
-        processOSTypeList(doc, &oldReleasesRoot, oldReleases);
-    }
-    if(testReleases.length()) {
-        QDomElement testReleasesRoot = doc->createElement("test_release");
-        root.appendChild(testReleasesRoot);
-        processOSTypeList(doc, &testReleasesRoot, testReleases);
-    }
-    QString ret = doc->toString(4);
-    delete doc;
-    return ret;
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    writeXML(SoftCatalog(list), &buffer);
+    return QString::fromUtf8(buffer.data());
 }
 
 QList<xmlParser::osTypeEnum> xmlParser::osTypesList()
@@ -414,18 +264,6 @@ QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> xmlParser::temp()
     return parsed;
 }
 
-QList<QDomElement> xmlParser::nodesToElementList(QDomNodeList list)
-{
-    QList<QDomElement> ret;
-    int x = list.length();
-    for (int i = 0; i < x; ++i) {
-        if(list.at(i).isElement()) {
-            ret.append(list.at(i).toElement());
-        }
-    }
-    return ret;
-}
-
 QHash<xmlParser::osTypeEnum, QString> xmlParser::osHashInit()
 {
     QHash<xmlParser::osTypeEnum, QString>  temp;
@@ -436,13 +274,6 @@ QHash<xmlParser::osTypeEnum, QString> xmlParser::osHashInit()
     temp.insert(OS_OSX64, "OSX 64bit");
     temp.insert(OS_WIN32, "Windows 32bit");
     temp.insert(OS_WIN64, "Windows 64bit");
-    temp.insert(OS_EMBEDED, "Embeded");
-    temp.insert(OS_LINUX32, "Linux 32bit");
-    temp.insert(OS_LINUX64, "Linux 64bit");
-    temp.insert(OS_OSX32, "OSX 32bit");
-    temp.insert(OS_OSX64, "OSX 64bit");
-    temp.insert(OS_WIN32, "Windows 32bit");
-    temp.insert(OS_WIN64, "Windows 64bit");
     return temp;
 }
 
@@ -471,7 +302,6 @@ QHash<int, QString> xmlParser::hwTypeInit()
     temp.insert(133, "Discoveryf4");
     temp.insert(134, "Quanton");
     temp.insert(4, "CopterControl");
-    temp.insert(3, "PipXtreme");
     temp.insert(127, "Revolution");
     temp.insert(9, "RevoMini");
     temp.insert(0, "none");
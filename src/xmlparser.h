@@ -31,7 +31,11 @@
 #include <QHash>
 #include <QUrl>
 #include <QDate>
-#include <QDomElement>
+#include <QIODevice>
+
+class QXmlStreamWriter;
+class SoftCatalog;
+class CatalogReader;
 
 class xmlParser : public QObject
 {
@@ -55,8 +59,9 @@ public:
     xmlParser(QObject *parent = NULL);
     ~xmlParser();
     QMultiHash<releaseTypeEnum, softData> parseXML(QString xml, bool &success);
-    void processOSTypeList(QDomDocument *doc, QDomElement *element, QList<xmlParser::softData> data);
-    void processSoftType(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data);
+    QMultiHash<releaseTypeEnum, softData> parseXML(QIODevice *device, bool &success);
+    bool parseXML(QIODevice *device, SoftCatalog &catalog);
+    void writeXML(const SoftCatalog &catalog, QIODevice *device, bool compact = false);
     QString convertSoftDataToXMLString(QMultiHash<releaseTypeEnum, softData> list);
     static QList<xmlParser::osTypeEnum> osTypesList();
     static QString softTypeToString(xmlParser::softTypeEnum type);
@@ -67,17 +72,13 @@ public:
     QMultiHash<releaseTypeEnum, softData> temp();
 
 
-    QHash<xmlParser::osTypeEnum, QString> osHashInit();
-    QHash<xmlParser::softTypeEnum, QString> softHashInit();
-    QHash<int, QString> hwTypeInit();
+    static QHash<xmlParser::osTypeEnum, QString> osHashInit();
+    static QHash<xmlParser::softTypeEnum, QString> softHashInit();
+    static QHash<int, QString> hwTypeInit();
 signals:
     void outputMessage(QString);
 private:
-    void xmlAddFields(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data);
-    void processHwType(QDomDocument *doc, QDomElement &element, QList<xmlParser::softData> data);
-    xmlParser::softData assembleSoftData(osTypeEnum os, softTypeEnum soft, quint16 hwID, QDomElement element);
-    QList<QDomElement> nodesToElementList(QDomNodeList list);
-    QDomDocument tempDoc;
+    bool finishParse(CatalogReader &reader);
     QByteArray array;
     QMultiHash<xmlParser::releaseTypeEnum, xmlParser::softData> tempv;
 